@@ -1,6 +1,9 @@
 #pragma once
 
 #include <variant>
+#include <span>
+#include <cstdint>
+#include <concepts>
 
 #include "../util/util.hpp"
 
@@ -13,44 +16,154 @@ namespace BPsimulation::core::agent {
 	};
 
 	template<class Agent>
-	class AgentInteractionFunctionTemplate {
-	protected:
-		template<class Agent2>
-		const Agent2* random_select(const std::vector<std::pair<const Agent2*, double>> neighbors) const {
-			static_assert(std::is_convertible<Agent2, Agent>::value, "Error: Agent class is not compatible with the one used by AgentInteractionFunctionTemplate in random_select !");
+	class NeighborView {
+		/* non-owning view over the neighbors of a node: agent pointers are computed on the fly
+		from the network agent array, so the agent array can hold a class derived from Agent */
+	private:
+		const char*               first_agent = NULL;
+		size_t                    stride      = sizeof(Agent);
+		std::span<const uint32_t> indexes;
+		std::span<const double>   weights;
+		const double             *sampling_probas = NULL;
+		const uint32_t           *sampling_alias  = NULL;
 
-			if (neighbors.empty()) {
-				return NULL;
+	public:
+		typedef std::pair<const Agent*, double> value_type;
+
+		class iterator {
+		private:
+			const NeighborView<Agent> *view;
+			size_t                     idx;
+		public:
+			iterator(const NeighborView<Agent> *view_, size_t idx_) : view(view_), idx(idx_) {}
+
+			inline value_type operator*() const {
+				return (*view)[idx];
 			}
+			inline iterator& operator++() {
+				++idx;
+				return *this;
+			}
+			inline bool operator==(const iterator &other) const {
+				return idx == other.idx;
+			}
+		};
+
+		NeighborView() {}
+		template<class Agent2>
+		NeighborView(const Agent2 *agents, std::span<const uint32_t> indexes_, std::span<const double> weights_) :
+			first_agent((const char*)(const Agent*)agents), stride(sizeof(Agent2)), indexes(indexes_), weights(weights_)
+		{
+			static_assert(std::is_convertible<Agent2, Agent>::value, "Error: Agent class is not compatible with the one used by NeighborView !");
+		}
+
+		inline size_t size() const {
+			return indexes.size();
+		}
+		inline bool empty() const {
+			return indexes.empty();
+		}
+		inline const Agent* agent(size_t idx) const {
+			return (const Agent*)(first_agent + stride*indexes[idx]);
+		}
+		inline double weight(size_t idx) const {
+			return weights[idx];
+		}
+		inline size_t index(size_t idx) const {
+			return indexes[idx];
+		}
+		inline value_type operator[](size_t idx) const {
+			return {agent(idx), weight(idx)};
+		}
 
-			std::vector<double> probas(neighbors.size());
+		inline void set_sampling_table(const double *probas, const uint32_t *alias) {
+			sampling_probas = probas;
+			sampling_alias  = alias;
+		}
+		size_t random_index() const {
+			/* O(1) draw from the alias table if the network provided one, otherwise linear scan */
+			if (sampling_probas != NULL) {
+				std::uniform_int_distribution<size_t>  idx_distribution(0, size()-1);
+				std::uniform_real_distribution<double> distribution(0.d, 1.d);
 
-			probas[0] = neighbors[0].second;
-			for (size_t i = 1; i < neighbors.size(); ++i) {
-				probas[i] = probas[i-1] + neighbors[i].second;
+				size_t idx = idx_distribution(util::get_random_generator());
+				return distribution(util::get_random_generator()) < sampling_probas[idx] ? idx : sampling_alias[idx];
 			}
 
-			std::uniform_real_distribution<double> distribution(0.d, probas.back());
+			double total_weight = 0;
+			for (size_t idx = 0; idx < size(); ++idx) {
+				total_weight += weight(idx);
+			}
+
+			std::uniform_real_distribution<double> distribution(0.d, total_weight);
 			double rng_value = distribution(util::get_random_generator());
 
-			size_t neighbor_idx = 0;
-			while (rng_value > 0 && neighbor_idx <= neighbors.size()) {
-				rng_value -= probas[neighbor_idx];
-				++neighbor_idx;
+			size_t idx = 0;
+			while (idx < size()-1 && rng_value >= weight(idx)) {
+				rng_value -= weight(idx);
+				++idx;
 			}
-			--neighbor_idx;
 
-			return neighbors[neighbor_idx].first;
+			return idx;
+		}
+
+		inline iterator begin() const {
+			return iterator(this, 0);
+		}
+		inline iterator end() const {
+			return iterator(this, size());
+		}
+	};
+
+	template<class Func, class Default>
+	struct function_agent_type {
+		typedef Default type;
+	};
+	template<class Func, class Default>
+		requires requires { typename Func::agent_type; }
+	struct function_agent_type<Func, Default> {
+		typedef typename Func::agent_type type;
+	};
+	/* agent type a functor works on: the one of the template it derives from, or the network agent type for plain callables */
+	template<class Func, class Default>
+	using function_agent_type_t = typename function_agent_type<Func, Default>::type;
+
+	template<class Func, class Agent>
+	concept AgentInteractionFunction = requires(const Func &func, Agent &agent, NeighborView<Agent> neighbors) {
+		func(agent, neighbors);
+	};
+	template<class Func, class Agent>
+	concept AgentWiseUpdateFunction = requires(const Func &func, Agent &agent) {
+		func(agent);
+	};
+
+	template<class Agent>
+	class AgentInteractionFunctionTemplate {
+	protected:
+		template<class Agent2>
+		const Agent2* random_select(const NeighborView<Agent2> &neighbors) const {
+			static_assert(std::is_convertible<Agent2, Agent>::value, "Error: Agent class is not compatible with the one used by AgentInteractionFunctionTemplate in random_select !");
+
+			if (neighbors.empty()) {
+				return NULL;
+			}
+
+			return neighbors.agent(neighbors.random_index());
 		}
 
 	public:
-		virtual void operator()(Agent &agent, std::vector<std::pair<const Agent*, double>> neighbors) const {}
+		typedef Agent agent_type;
+
+		virtual void operator()(Agent &agent, NeighborView<Agent> neighbors) const {}
+		virtual bool uses_random_select() const { return false; }
 		virtual std::vector<Agent> list_of_possible_agents() const { return {}; }
 	};
 
 	template<class Agent>
 	class AgentWiseUpdateFunctionTemplate {
 	public:
+		typedef Agent agent_type;
+
 		virtual void operator()(Agent &agent) const {}
 	};
 
@@ -73,8 +186,95 @@ namespace BPsimulation::core::agent {
 	public:
 		typedef std::variant<bool, int, unsigned int, long, size_t, float, double> variable_type;
 
+		/* one column per field, the alternative index being the type id of the field (bools are stored as chars) */
+		typedef std::variant<
+			std::vector<char>, std::vector<int>,    std::vector<unsigned int>,
+			std::vector<long>, std::vector<size_t>, std::vector<float>,
+			std::vector<double>> column_type;
+
 		virtual std::vector<std::pair<std::string, int>> list_of_fields() const { return {}; }
 		virtual std::vector<variable_type> write(const Agent &agent) const { return {}; }
 		virtual void read(Agent &agent, const std::vector<variable_type> &values) const {}
+
+		/* columnar interface, writing (or reading) a whole column per field for all agents at once.
+		The default goes through write and read agent per agent, serializers override it to fill typed columns directly */
+		virtual void write_columns(std::span<const Agent> agents, std::vector<column_type> &columns) const {
+			#pragma omp parallel for
+			for (size_t node = 0; node < agents.size(); ++node) {
+				std::vector<variable_type> values = write(agents[node]);
+				for (size_t ifield = 0; ifield < columns.size(); ++ifield) {
+					set_column_value(columns[ifield], node, values[ifield]);
+				}
+			}
+		}
+		virtual void read_columns(std::span<Agent> agents, const std::vector<column_type> &columns) const {
+			#pragma omp parallel
+			{
+				std::vector<variable_type> values(columns.size());
+
+				#pragma omp for
+				for (size_t node = 0; node < agents.size(); ++node) {
+					for (size_t ifield = 0; ifield < columns.size(); ++ifield) {
+						values[ifield] = get_column_value(columns[ifield], node);
+					}
+					read(agents[node], values);
+				}
+			}
+		}
+
+		std::vector<column_type> make_columns(size_t num_agents) const {
+			std::vector<std::pair<std::string, int>> list_of_fields_ = list_of_fields();
+			std::vector<column_type>                 columns(list_of_fields_.size());
+
+			for (size_t ifield = 0; ifield < list_of_fields_.size(); ++ifield) {
+				columns[ifield] = make_column(list_of_fields_[ifield].second, num_agents);
+			}
+
+			return columns;
+		}
+
+		static column_type make_column(int type_id, size_t num_agents) {
+			switch (type_id) {
+			case 0:
+				return std::vector<char>(        num_agents);
+			case 1:
+				return std::vector<int>(         num_agents);
+			case 2:
+				return std::vector<unsigned int>(num_agents);
+			case 3:
+				return std::vector<long>(        num_agents);
+			case 4:
+				return std::vector<size_t>(      num_agents);
+			case 5:
+				return std::vector<float>(       num_agents);
+			default:
+				return std::vector<double>(      num_agents);
+			}
+		}
+		static void set_column_value(column_type &column, size_t node, const variable_type &value) {
+			std::visit([&](auto &column_) {
+				std::visit([&](auto value_) {
+					column_[node] = (typename std::decay_t<decltype(column_)>::value_type)value_;
+				}, value);
+			}, column);
+		}
+		static variable_type get_column_value(const column_type &column, size_t node) {
+			return std::visit([&](const auto &column_) -> variable_type {
+				if constexpr (std::is_same_v<typename std::decay_t<decltype(column_)>::value_type, char>) {
+					return (bool)column_[node];
+				} else {
+					return column_[node];
+				}
+			}, column);
+		}
+		/* typed access to a column, the type having to match the type id of the field (char for bools) */
+		template<typename Type>
+		static std::span<Type> column(column_type &column_) {
+			return std::span<Type>(std::get<std::vector<Type>>(column_));
+		}
+		template<typename Type>
+		static std::span<const Type> column(const column_type &column_) {
+			return std::span<const Type>(std::get<std::vector<Type>>(column_));
+		}
 	};
 }
\ No newline at end of file
@@ -1,31 +1,73 @@
 #pragma once
 
+#include <array>
+#include <span>
+#include <stdexcept>
+
 #include "../agent.hpp"
 
 #include "../../util/util.hpp"
 
 
 namespace BPsimulation::core::agent::population {
+	/* number of agent types, known at compile time if Agent defines num_possible_agents */
 	template<class Agent>
-	class AgentPopulation : public AgentTemplate {
-	private:
-		std::vector<Agent> agent_types_;
+	struct num_agent_types {
+		static const size_t value = std::dynamic_extent;
+	};
+	template<class Agent>
+		requires requires { { Agent::num_possible_agents } -> std::convertible_to<size_t>; }
+	struct num_agent_types<Agent> {
+		static const size_t value = Agent::num_possible_agents;
+	};
 
+	template<class Agent>
+	class AgentPopulation : public AgentTemplate {
 	public:
-		AgentPopulation() {
-			Agent* mock_agent   = new Agent();
-			       agent_types_ = mock_agent->list_of_possible_agents();
-			delete mock_agent;
+		static const size_t num_types = num_agent_types<Agent>::value;
+
+		/* fixed-size arrays when the number of agent types is known at compile time, so that
+		proportions are stored inline (at a fixed stride in the network) and the per-type
+		temporaries of the interaction step do not allocate */
+		template<typename T>
+		using per_type_array = typename std::conditional<num_types == std::dynamic_extent,
+			std::vector<T>,
+			std::array<T, num_types>>::type;
+		typedef per_type_array<double> proportions_type;
+
+		template<typename T>
+		static inline per_type_array<T> make_per_type_array(T value) {
+			per_type_array<T> array;
+			if constexpr (num_types == std::dynamic_extent) {
+				array.resize(agent_types().size());
+			}
+			std::fill(array.begin(), array.end(), value);
+			return array;
+		}
 
-			proportions.resize(agent_types().size());
+		AgentPopulation() {
+			if constexpr (num_types == std::dynamic_extent) {
+				proportions.resize(agent_types().size());
+			}
 		}
 
-		inline const std::vector<Agent> &agent_types() const {
+		/* shared by all agents */
+		static inline const std::vector<Agent> &agent_types() {
+			static const std::vector<Agent> agent_types_ = []() {
+				Agent mock_agent;
+				std::vector<Agent> list_of_possible_agents = mock_agent.list_of_possible_agents();
+
+				/* proportions are fixed-size arrays of num_types elements, indexed by the agent types */
+				if (num_types != std::dynamic_extent && list_of_possible_agents.size() != num_types) {
+					throw std::invalid_argument("in \"AgentPopulation::agent_types\", list_of_possible_agents() doesn't return num_possible_agents agents");
+				}
+				return list_of_possible_agents;
+			}();
 			return agent_types_;
 		}
 
 		size_t population = 1;
-		std::vector<double> proportions;
+		proportions_type proportions = {};
 
 		void randomize(const std::vector<double> &mean_proportions, const std::vector<double> &proportions_var) {
 			for (int i = 0; i < agent_types().size(); ++i) {
@@ -64,7 +106,7 @@ namespace BPsimulation::core::agent::population {
 				proportion /= normalization_factor;
 			}
 		}
-		void integrate_proportion_variation(const std::vector<double> &agent_proportion_delta) {
+		void integrate_proportion_variation(const proportions_type &agent_proportion_delta) {
 			size_t num_fields = proportions.size();
 			for (size_t ifield = 0; ifield < num_fields; ++ifield) {
 				proportions[ifield] = proportions[ifield] + agent_proportion_delta[ifield];
@@ -72,7 +114,7 @@ namespace BPsimulation::core::agent::population {
 
 			renormalize();
 		}
-		void integrate_population_variation(const std::vector<double> &agent_populations_delta) {
+		void integrate_population_variation(const proportions_type &agent_populations_delta) {
 			size_t num_fields = proportions.size();
 			for (size_t ifield = 0; ifield < num_fields; ++ifield) {
 				proportions[ifield] = (proportions[ifield]*population + agent_populations_delta[ifield])/population;
@@ -82,33 +124,27 @@ namespace BPsimulation::core::agent::population {
 		}
 
 		template<class Agent2>
-		std::vector<double> random_select(
+		proportions_type random_select(
 			size_t N_select,
-			const std::vector<std::pair<const Agent2*, double>> neighbors,
+			const NeighborView<Agent2> &neighbors,
 			const bool include_self=false,
-			const std::vector<size_t> &unselectable={}
+			std::span<const size_t> unselectable={}
 		) const {
 			static_assert(std::is_convertible<Agent2, AgentPopulation<Agent>>::value, "Error: Agent class is not compatible with the one used by AgentPopulationInteractionFunctionTemplate in random_select !");
-			if (neighbors.empty() && !include_self) {
-				Agent* mock_agent = new Agent();
-				size_t num_fields = mock_agent->list_of_possible_agents().size();
 
-				return std::vector<double>(num_fields, 0);
+			proportions_type selected = make_per_type_array<double>(0);
+			if (neighbors.empty() && !include_self) {
+				return selected;
 			}
 
-			size_t num_fields;
-			if (include_self) {
-				num_fields = proportions.size();
-			} else {
-				num_fields = neighbors[0].first->proportions.size();
-			}
+			const size_t num_fields = selected.size();
 
-			std::vector<char> is_selectable(num_fields, true);
+			per_type_array<char> is_selectable = make_per_type_array<char>(true);
 			for (size_t unselectable_field : unselectable) {
 				is_selectable[unselectable_field] = false;
 			}
 
-			std::vector<double> accumulated_proportions(num_fields, 0);
+			proportions_type accumulated_proportions = make_per_type_array<double>(0);
 			double accumulated_population=0.d, normalization_factor=0.d;
 			for (size_t ifield = 0; ifield < num_fields; ++ifield) {
 				if (is_selectable[ifield]) {
@@ -126,7 +162,6 @@ namespace BPsimulation::core::agent::population {
 				}
 			}
 
-			std::vector<double> selected(num_fields, 0);
 			if (normalization_factor == 0) {
 				return selected;
 			}
@@ -159,38 +194,48 @@ namespace BPsimulation::core::agent::population {
 
 			return selected;
 		}
-		inline std::vector<double> random_select_self(size_t N_select, const std::vector<size_t> &unselectable={}) const {
-			return random_select(N_select, std::vector<std::pair<const AgentPopulation<Agent>*, double>>{}, true, unselectable);
+		inline proportions_type random_select_self(size_t N_select, std::span<const size_t> unselectable={}) const {
+			return random_select(N_select, NeighborView<AgentPopulation<Agent>>{}, true, unselectable);
 		}
 	};
 
-	template<class Agent>
-	class PopulationElection : public election::ElectionTemplate<AgentPopulation<Agent>> {
+	template<class Agent, class BaseElection=election::ElectionTemplate<Agent>>
+	class PopulationElection final : public election::ElectionTemplate<AgentPopulation<Agent>> {
 	private:
-		const election::ElectionTemplate<Agent> *base_election_func;
+		const BaseElection *base_election_func;
+
+		template<class Result>
+		inline void accumulate_population(Result &result, const AgentPopulation<Agent>& agent, size_t N) const {
+			const std::vector<Agent> &agent_types = AgentPopulation<Agent>::agent_types();
+			for (size_t i = 0; i < agent_types.size(); ++i) {
+				size_t agent_type_population = size_t(agent.population*agent.proportions[i]);
+				base_election_func->accumulate(result, agent_types[i], N*agent_type_population);
+			}
+		}
 	public:
-		PopulationElection(const election::ElectionTemplate<Agent> *electionfunc) : base_election_func(electionfunc) {}
+		/* only defined (to something else than void) if BaseElection is a concrete election */
+		typedef typename election::election_result_type<BaseElection>::type result_type;
+
+		PopulationElection(const BaseElection *electionfunc) : base_election_func(electionfunc) {}
 
 		election::ElectionResultTemplate* get_neutral_election_result() const { 
 			return base_election_func->get_neutral_election_result();
 		};
+		void accumulate(election::ElectionResultTemplate &result, const AgentPopulation<Agent>& agent, size_t N=1) const {
+			accumulate_population(result, agent, N);
+		}
 		election::ElectionResultTemplate* operator()(const AgentPopulation<Agent>& agent) const {
-			election::ElectionResultTemplate *result = get_neutral_election_result();
-			for (int i = 0; i < agent.agent_types().size(); ++i) {
-				election::ElectionResultTemplate *type_result = (*base_election_func)(agent.agent_types()[i]);
-
-				int agent_type_population = int(agent.population*agent.proportions[i]);
-				(*type_result) *= agent_type_population;
-
-				(*result) += type_result;
-			}
-
-			return result;
-		};
+			return this->accumulate_to_neutral_result(agent);
+		}
+		template<class Result>
+			requires std::same_as<Result, result_type>
+		void accumulate(Result &result, const AgentPopulation<Agent>& agent, size_t N=1) const {
+			accumulate_population(result, agent, N);
+		}
 	};
 
 	template<class Agent>
-	class PopulationRenormalizeProportions : public AgentWiseUpdateFunctionTemplate<AgentPopulation<Agent>> {
+	class PopulationRenormalizeProportions final : public AgentWiseUpdateFunctionTemplate<AgentPopulation<Agent>> {
 	public:
 		PopulationRenormalizeProportions() {}
 		void operator()(AgentPopulation<Agent> &agent) const {
@@ -202,10 +247,10 @@ namespace BPsimulation::core::agent::population {
 	class AgentPopulationSerializer : public AgentSerializerTemplate<AgentPopulation<Agent>> {
 	public:
 		using variable_type = std::variant<bool, int, unsigned int, long, size_t, float, double>;
+		using column_type   = typename AgentSerializerTemplate<AgentPopulation<Agent>>::column_type;
 		
 		std::vector<std::pair<std::string, int>> list_of_fields() const {
-			Agent* mock_agent = new Agent();
-			size_t num_fields = 1 + mock_agent->list_of_possible_agents().size();
+			size_t num_fields = 1 + AgentPopulation<Agent>::agent_types().size();
 
 			std::vector<std::pair<std::string, int>> list_of_fields_(num_fields);
 			for (size_t ifield = 0; ifield < num_fields-1; ++ifield) {
@@ -236,5 +281,50 @@ namespace BPsimulation::core::agent::population {
 			}
 			agent.population = std::get<size_t>(values[num_fields-1]);
 		}
+
+		void write_columns(std::span<const AgentPopulation<Agent>> agents, std::vector<column_type> &columns) const {
+			write_population_columns(agents, columns);
+		}
+		void read_columns(std::span<AgentPopulation<Agent>> agents, const std::vector<column_type> &columns) const {
+			read_population_columns(agents, columns);
+		}
+
+		/* fills the leading proportion and population columns, also for agents deriving from AgentPopulation */
+		template<class Agent2>
+		void write_population_columns(std::span<const Agent2> agents, std::vector<column_type> &columns) const {
+			const size_t num_types = AgentPopulation<Agent>::agent_types().size();
+
+			std::vector<std::span<double>> proportions(num_types);
+			for (size_t ifield = 0; ifield < num_types; ++ifield) {
+				proportions[ifield] = this->template column<double>(columns[ifield]);
+			}
+			std::span<size_t> population = this->template column<size_t>(columns[num_types]);
+
+			#pragma omp parallel for
+			for (size_t node = 0; node < agents.size(); ++node) {
+				for (size_t ifield = 0; ifield < num_types; ++ifield) {
+					proportions[ifield][node] = agents[node].proportions[ifield];
+				}
+				population[node] = agents[node].population;
+			}
+		}
+		template<class Agent2>
+		void read_population_columns(std::span<Agent2> agents, const std::vector<column_type> &columns) const {
+			const size_t num_types = AgentPopulation<Agent>::agent_types().size();
+
+			std::vector<std::span<const double>> proportions(num_types);
+			for (size_t ifield = 0; ifield < num_types; ++ifield) {
+				proportions[ifield] = this->template column<double>(columns[ifield]);
+			}
+			std::span<const size_t> population = this->template column<size_t>(columns[num_types]);
+
+			#pragma omp parallel for
+			for (size_t node = 0; node < agents.size(); ++node) {
+				for (size_t ifield = 0; ifield < num_types; ++ifield) {
+					agents[node].proportions[ifield] = proportions[ifield][node];
+				}
+				agents[node].population = population[node];
+			}
+		}
 	};
 }
\ No newline at end of file
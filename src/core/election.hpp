@@ -6,6 +6,8 @@
 namespace BPsimulation::core::election {
 	class ElectionResultTemplate {
 	public:
+		virtual ~ElectionResultTemplate() {};
+
 		virtual ElectionResultTemplate& operator+=(const ElectionResultTemplate*) { return *this; };
 		virtual ElectionResultTemplate& operator*=(size_t N) { return *this; };
 		virtual void post_process() {};
@@ -14,16 +16,67 @@ namespace BPsimulation::core::election {
 	template<class Agent>
 	class ElectionTemplate {
 	public:
+		typedef Agent agent_type;
+
 		virtual ElectionResultTemplate* get_neutral_election_result() const { return NULL; };
-		virtual ElectionResultTemplate* operator()(const Agent&) const { return NULL; };
+		/* plugin-style models only override operator() (returning NULL by default, meaning no vote),
+		the default accumulate then going through a temporary result.
+		Concrete models override accumulate to add the vote(s) of N agents identical to agent into result without allocating,
+		and operator() by returning accumulate_to_neutral_result(agent) */
+		virtual void accumulate(ElectionResultTemplate &result, const Agent &agent, size_t N=1) const {
+			ElectionResultTemplate *agent_result = (*this)(agent);
+			if (agent_result != NULL) {
+				*agent_result *= N;
+				result        += agent_result;
+				delete agent_result;
+			}
+		};
+		virtual ElectionResultTemplate* operator()(const Agent &agent) const { return NULL; };
+
+	protected:
+		/* only to be called from operator() by models overriding accumulate, as it would otherwise recurse */
+		ElectionResultTemplate* accumulate_to_neutral_result(const Agent &agent) const {
+			ElectionResultTemplate *result = get_neutral_election_result();
+			if (result != NULL) {
+				accumulate(*result, agent);
+			}
+			return result;
+		};
 	};
 
 	template<class Agent>
 	class ElectionRetroinfluenceTemplate {
 	public:
+		typedef Agent agent_type;
+
 		virtual void operator()(Agent&, const ElectionResultTemplate*) const {};
 	};
 
+	template<class Func>
+	struct election_result_type {
+		typedef void type;
+	};
+	template<class Func>
+		requires requires { typename Func::result_type; }
+	struct election_result_type<Func> {
+		typedef typename Func::result_type type;
+	};
+
+	/* elections with a value-typed result_type, accumulated in place by the compile-time dispatch path */
+	template<class Func, class Agent>
+	concept Election =
+		std::derived_from<typename election_result_type<Func>::type, ElectionResultTemplate> &&
+		std::default_initializable<typename election_result_type<Func>::type> &&
+		requires(const Func &func, const Agent &agent, typename election_result_type<Func>::type &result) {
+			func.accumulate(result, agent, (size_t)1);
+			result += result;
+			result.post_process();
+		};
+	template<class Func, class Agent>
+	concept ElectionRetroinfluence = requires(const Func &func, Agent &agent, const ElectionResultTemplate *election_result) {
+		func(agent, election_result);
+	};
+
 	class ElectionResultSerializerTemplate : public agent::AgentSerializerTemplate<ElectionResultTemplate> {
 	private:
 		using AgentSerializerTemplate<ElectionResultTemplate>::read; // to make read private as it shouldn't be used for elections !
@@ -5,6 +5,9 @@
 #include <algorithm>
 #include <numeric>
 #include <random>
+#include <span>
+#include <cstdint>
+#include <stdexcept>
 
 #include "election.hpp"
 #include "agent.hpp"
@@ -16,32 +19,234 @@ namespace BPsimulation {
 	template<class Agent>
 	class SocialNetwork {
 	private:
-		std::vector<Agent>               agent_vect, placeholder;
-		std::vector<std::vector<size_t>> connection_matrix; 
-		std::vector<std::vector<double>> weight_matrix; 
+		std::vector<Agent>                 agent_vect, placeholder;
+		std::vector<size_t>                node_order;
+		std::vector<std::vector<uint32_t>> connection_matrix; 
+		std::vector<std::vector<double>>   weight_matrix; 
+
+		/* frozen (CSR) representation, the neighbors of node i are
+		csr_neighbors[csr_offsets[i]] to csr_neighbors[csr_offsets[i+1]-1] */
+		bool                  frozen = false;
+		std::vector<size_t>   csr_offsets;
+		std::vector<uint32_t> csr_neighbors;
+		std::vector<double>   csr_weights;
+
+		/* per-node Walker alias tables for weighted neighbor sampling, rebuilt before
+		interacting whenever a connection or a weight changed.
+		Weights written through a reference from get_connection_weight_ref can't be tracked, so once one was handed out
+		the tables are rebuilt before every interaction, until freeze or thaw reallocate the weights (invalidating the references) */
+		bool                  sampling_tables_valid = false, weights_externally_mutable = false;
+		std::vector<size_t>   sampling_offsets;
+		std::vector<double>   sampling_probas;
+		std::vector<uint32_t> sampling_alias;
+
+		/* greedy coloring of the (symmetrized) graph used by interact_colored, nodes of color c
+		are color_nodes[color_offsets[c]] to color_nodes[color_offsets[c+1]-1] */
+		bool                  coloring_valid = false;
+		std::vector<size_t>   color_offsets;
+		std::vector<uint32_t> color_nodes;
+		std::vector<size_t>   color_order;
 
 
 		template<class Agent2>
-		std::vector<std::pair<const Agent2*, double>> get_neighbors(size_t node) const {
+		inline core::agent::NeighborView<Agent2> get_neighbors(size_t node) const {
 			static_assert(std::is_convertible<Agent, Agent2>::value, "Error: Agent class is not compatible with the one seeked in get_neighbors (private function of SocialNetwork) !");
 
-			std::vector<std::pair<const Agent2*, double>> vec;
+			core::agent::NeighborView<Agent2> view(agent_vect.data(), neighbors(node), neighbor_weights(node));
+			if (sampling_tables_valid) {
+				view.set_sampling_table(
+					sampling_probas.data() + sampling_offsets[node],
+					sampling_alias.data()  + sampling_offsets[node]);
+			}
 
-			std::vector<size_t> neighbor_list = neighbors(node);
-			for (size_t neighbor_idx = 0; neighbor_idx < neighbor_list.size(); ++neighbor_idx) {
-				size_t neighbor = neighbor_list[neighbor_idx];
+			return view;
+		}
 
-				vec.push_back(std::pair<const Agent2*, double>{
-					(const Agent2*)&(*this)[neighbor],
-					weight_matrix[node][neighbor_idx]
-				});
+		void build_sampling_tables() {
+			sampling_offsets.assign(num_nodes()+1, 0);
+			for (size_t node = 0; node < num_nodes(); ++node) {
+				sampling_offsets[node+1] = sampling_offsets[node] + degree(node);
+			}
+			sampling_probas.resize(sampling_offsets.back());
+			sampling_alias.resize( sampling_offsets.back());
+
+			std::vector<uint32_t> small, large;
+
+			#pragma omp parallel for schedule(dynamic, 1024) private(small, large)
+			for (size_t node = 0; node < num_nodes(); ++node) {
+				std::span<const double> weights = neighbor_weights(node);
+				double   *probas = sampling_probas.data() + sampling_offsets[node];
+				uint32_t *alias  = sampling_alias.data()  + sampling_offsets[node];
+
+				const size_t node_degree  = weights.size();
+				const double total_weight = std::accumulate(weights.begin(), weights.end(), 0.d);
+
+				small.clear();
+				large.clear();
+				for (size_t idx = 0; idx < node_degree; ++idx) {
+					probas[idx] = total_weight > 0 ? weights[idx]*node_degree/total_weight : 1.d;
+					alias[ idx] = idx;
+
+					if (probas[idx] < 1) {
+						small.push_back(idx);
+					} else {
+						large.push_back(idx);
+					}
+				}
+
+				/* Vose's alias method */
+				while (!small.empty() && !large.empty()) {
+					uint32_t small_idx = small.back(), large_idx = large.back();
+					small.pop_back();
+
+					alias[small_idx]  = large_idx;
+					probas[large_idx] = probas[large_idx] + probas[small_idx] - 1;
+
+					if (probas[large_idx] < 1) {
+						large.pop_back();
+						small.push_back(large_idx);
+					}
+				}
+				for (uint32_t idx : large) {
+					probas[idx] = 1;
+				}
+				for (uint32_t idx : small) {
+					probas[idx] = 1;
+				}
+			}
+
+			sampling_tables_valid = true;
+		}
+		template<class Func>
+		inline void update_sampling_tables(const Func &interactionfunc) {
+			if constexpr (requires { interactionfunc.uses_random_select(); }) {
+				if ((!sampling_tables_valid || weights_externally_mutable) && interactionfunc.uses_random_select()) {
+					build_sampling_tables();
+				}
+			}
+		}
+
+		void build_coloring() {
+			/* two nodes conflict if either one reads the other, so incoming edges are needed too */
+			std::vector<size_t> reverse_offsets(num_nodes()+1, 0);
+			for (size_t node = 0; node < num_nodes(); ++node) {
+				for (uint32_t neighbor : neighbors(node)) {
+					++reverse_offsets[neighbor+1];
+				}
+			}
+			std::partial_sum(reverse_offsets.begin(), reverse_offsets.end(), reverse_offsets.begin());
+
+			std::vector<uint32_t> reverse_neighbors(reverse_offsets.back());
+			std::vector<size_t>   reverse_fill(reverse_offsets.begin(), reverse_offsets.end()-1);
+			for (size_t node = 0; node < num_nodes(); ++node) {
+				for (uint32_t neighbor : neighbors(node)) {
+					reverse_neighbors[reverse_fill[neighbor]++] = node;
+				}
+			}
+
+			/* greedy coloring, each node takes the smallest color not used by an already colored neighbor */
+			std::vector<uint32_t> colors(num_nodes());
+			std::vector<size_t>   color_mark;
+			size_t num_colors_ = 0;
+			for (size_t node = 0; node < num_nodes(); ++node) {
+				for (uint32_t neighbor : neighbors(node)) {
+					if (neighbor < node) {
+						color_mark[colors[neighbor]] = node+1;
+					}
+				}
+				for (size_t idx = reverse_offsets[node]; idx < reverse_offsets[node+1]; ++idx) {
+					if (reverse_neighbors[idx] < node) {
+						color_mark[colors[reverse_neighbors[idx]]] = node+1;
+					}
+				}
+
+				size_t color = 0;
+				while (color < num_colors_ && color_mark[color] == node+1) {
+					++color;
+				}
+				if (color == num_colors_) {
+					++num_colors_;
+					color_mark.push_back(0);
+				}
+				colors[node] = color;
+			}
+
+			color_offsets.assign(num_colors_+1, 0);
+			for (size_t node = 0; node < num_nodes(); ++node) {
+				++color_offsets[colors[node]+1];
+			}
+			std::partial_sum(color_offsets.begin(), color_offsets.end(), color_offsets.begin());
+
+			color_nodes.resize(num_nodes());
+			std::vector<size_t> color_fill(color_offsets.begin(), color_offsets.end()-1);
+			for (size_t node = 0; node < num_nodes(); ++node) {
+				color_nodes[color_fill[colors[node]]++] = node;
+			}
+
+			color_order.resize(num_colors_);
+			std::iota(color_order.begin(), color_order.end(), 0);
+
+			coloring_valid = true;
+		}
+
+		static const size_t election_chunk_size = 1 << 12;
+
+		template<class Result, class NewResultFunc, class AccumulateFunc, class MergeFunc>
+		std::vector<Result> reduce_over_counties(std::span<const std::vector<size_t>> counties,
+			const NewResultFunc &new_result, const AccumulateFunc &accumulate, const MergeFunc &merge) const
+		{
+			/* counties are split into chunks of at most election_chunk_size nodes, so that a single
+			county is tallied by all threads, and a few large counties are balanced with many small ones */
+			std::vector<size_t> chunk_begin(counties.size()+1, 0);
+			size_t max_num_chunks = 1;
+			for (size_t i = 0; i < counties.size(); ++i) {
+				size_t num_chunks = std::max((size_t)1, (counties[i].size() + election_chunk_size - 1)/election_chunk_size);
+				chunk_begin[i+1] = chunk_begin[i] + num_chunks;
+				max_num_chunks   = std::max(max_num_chunks, num_chunks);
 			}
 
-			return vec;
+			std::vector<size_t> chunk_county(chunk_begin.back());
+			for (size_t i = 0; i < counties.size(); ++i) {
+				std::fill(chunk_county.begin() + chunk_begin[i], chunk_county.begin() + chunk_begin[i+1], i);
+			}
+
+			std::vector<Result> chunk_results(chunk_begin.back());
+
+			#pragma omp parallel for schedule(dynamic) if(chunk_results.size() > 1)
+			for (size_t ichunk = 0; ichunk < chunk_results.size(); ++ichunk) {
+				const std::vector<size_t> &county = counties[chunk_county[ichunk]];
+
+				size_t begin = (ichunk - chunk_begin[chunk_county[ichunk]])*election_chunk_size;
+				size_t end   = std::min(begin + election_chunk_size, county.size());
+
+				chunk_results[ichunk] = new_result();
+				for (size_t idx = begin; idx < end; ++idx) {
+					accumulate(chunk_results[ichunk], county[idx]);
+				}
+			}
+
+			/* pairwise tree reduction of the partial results of each county */
+			for (size_t stride = 1; stride < max_num_chunks; stride *= 2) {
+				#pragma omp parallel for schedule(dynamic)
+				for (size_t ichunk = 0; ichunk < chunk_results.size(); ++ichunk) {
+					size_t local_idx  = ichunk - chunk_begin[chunk_county[ichunk]];
+					size_t num_chunks = chunk_begin[chunk_county[ichunk]+1] - chunk_begin[chunk_county[ichunk]];
+
+					if (local_idx%(2*stride) == 0 && local_idx + stride < num_chunks) {
+						merge(chunk_results[ichunk], chunk_results[ichunk + stride]);
+					}
+				}
+			}
+
+			std::vector<Result> results(counties.size());
+			for (size_t i = 0; i < counties.size(); ++i) {
+				results[i] = std::move(chunk_results[chunk_begin[i]]);
+			}
+			return results;
 		}
 
 		std::pair<bool, size_t> get_neighbor_idx(size_t i, size_t j) const {
-			std::vector<size_t> i_neighbors = neighbors(i);
+			std::span<const uint32_t> i_neighbors = neighbors(i);
 
 			auto ptr = std::find(i_neighbors.begin(), i_neighbors.end(), j);
 			if (ptr == i_neighbors.end()) {
@@ -51,6 +256,19 @@ namespace BPsimulation {
 				return {true, idx};
 			}
 		}
+		inline double& weight_at(size_t i, size_t idx) {
+			sampling_tables_valid = false;
+
+			if (frozen) {
+				return csr_weights[csr_offsets[i] + idx];
+			}
+			return weight_matrix[i][idx];
+		}
+		inline void throw_if_frozen(const char* function_name) const {
+			if (frozen) {
+				throw std::runtime_error("in \"" + std::string(function_name) + "\", network is frozen, call thaw() before modifying its structure");
+			}
+		}
 	public:
 		SocialNetwork(size_t num_nodes=0) {
 			resize(num_nodes);
@@ -60,6 +278,11 @@ namespace BPsimulation {
 			return agent_vect.size();
 		}
 		inline void resize(size_t num_nodes) {
+			throw_if_frozen("resize");
+
+			sampling_tables_valid = false;
+			coloring_valid        = false;
+
 			agent_vect.resize(       num_nodes);
 			connection_matrix.resize(num_nodes);
 			weight_matrix.resize(    num_nodes);
@@ -75,23 +298,114 @@ namespace BPsimulation {
 		inline const Agent& operator[](size_t node) const {
 			return agent_vect[node];
 		}
+		inline std::span<Agent> agents() {
+			return agent_vect;
+		}
+		inline std::span<const Agent> agents() const {
+			return agent_vect;
+		}
 
-		inline const std::vector<size_t>& neighbors(size_t node) const {
+		inline bool is_frozen() const {
+			return frozen;
+		}
+		void freeze() {
+			if (frozen) {
+				return;
+			}
+
+			csr_offsets.assign(num_nodes()+1, 0);
+			for (size_t node = 0; node < num_nodes(); ++node) {
+				csr_offsets[node+1] = csr_offsets[node] + connection_matrix[node].size();
+			}
+
+			csr_neighbors.resize(csr_offsets.back());
+			csr_weights.resize(  csr_offsets.back());
+			#pragma omp parallel for
+			for (size_t node = 0; node < num_nodes(); ++node) {
+				std::copy(connection_matrix[node].begin(), connection_matrix[node].end(), csr_neighbors.begin() + csr_offsets[node]);
+				std::copy(weight_matrix[    node].begin(), weight_matrix[    node].end(), csr_weights.begin()   + csr_offsets[node]);
+			}
+
+			/* swap with empty vectors to actually release the per-node memory */
+			std::vector<std::vector<uint32_t>>().swap(connection_matrix);
+			std::vector<std::vector<double>>(  ).swap(weight_matrix);
+
+			weights_externally_mutable = false;
+			frozen                     = true;
+		}
+		void thaw() {
+			if (!frozen) {
+				return;
+			}
+
+			connection_matrix.resize(num_nodes());
+			weight_matrix.resize(    num_nodes());
+			#pragma omp parallel for
+			for (size_t node = 0; node < num_nodes(); ++node) {
+				connection_matrix[node].assign(csr_neighbors.begin() + csr_offsets[node], csr_neighbors.begin() + csr_offsets[node+1]);
+				weight_matrix[    node].assign(csr_weights.begin()   + csr_offsets[node], csr_weights.begin()   + csr_offsets[node+1]);
+			}
+
+			std::vector<size_t>(  ).swap(csr_offsets);
+			std::vector<uint32_t>().swap(csr_neighbors);
+			std::vector<double>(  ).swap(csr_weights);
+
+			weights_externally_mutable = false;
+			frozen                     = false;
+		}
+
+		/* replaces all connections at once, the neighbors of node i being neighbors_[offsets_[i]] to
+		neighbors_[offsets_[i+1]-1]. The buffers are moved in directly if the network is frozen */
+		void assign_connections(std::vector<size_t> &&offsets_, std::vector<uint32_t> &&neighbors_, std::vector<double> &&weights_) {
+			if (offsets_.size() != num_nodes()+1 || neighbors_.size() != offsets_.back() || weights_.size() != neighbors_.size()) {
+				throw std::invalid_argument("in \"assign_connections\", offsets, neighbors and weights sizes do not match the network");
+			}
+
+			sampling_tables_valid = false;
+			coloring_valid        = false;
+
+			if (frozen) {
+				csr_offsets   = std::move(offsets_);
+				csr_neighbors = std::move(neighbors_);
+				csr_weights   = std::move(weights_);
+			} else {
+				#pragma omp parallel for
+				for (size_t node = 0; node < num_nodes(); ++node) {
+					connection_matrix[node].assign(neighbors_.begin() + offsets_[node], neighbors_.begin() + offsets_[node+1]);
+					weight_matrix[    node].assign(weights_.begin()   + offsets_[node], weights_.begin()   + offsets_[node+1]);
+				}
+			}
+		}
+
+		inline std::span<const uint32_t> neighbors(size_t node) const {
+			if (frozen) {
+				return std::span<const uint32_t>(csr_neighbors.data() + csr_offsets[node], csr_offsets[node+1] - csr_offsets[node]);
+			}
 			return connection_matrix[node];
 		}
+		inline std::span<const double> neighbor_weights(size_t node) const {
+			if (frozen) {
+				return std::span<const double>(csr_weights.data() + csr_offsets[node], csr_offsets[node+1] - csr_offsets[node]);
+			}
+			return weight_matrix[node];
+		}
 
+		/* once a reference was handed out, the sampling tables are rebuilt before every interaction
+		(until the next freeze or thaw), so set_connection_weight should be preferred in a simulation loop */
 		inline double& get_connection_weight_ref(size_t i, size_t j) {
 			auto [are_connected, idx] = get_neighbor_idx(i, j);
 
 			if (!are_connected) {
 				throw std::invalid_argument("in \"get_connection_weight_ref\", i and j aren't neighors, can't return reference");
 			}
-			return weight_matrix[i][idx];
+
+			weights_externally_mutable = true;
+			return weight_at(i, idx);
 		}
 		inline const double get_connection_weight(size_t i, size_t j) const {
 			auto [are_connected, idx] = get_neighbor_idx(i, j);
 			if (are_connected) {
-				return weight_matrix[i][idx];
+				return neighbor_weights(i)[idx];
 			} else {
 				return 0;
 			}
@@ -99,8 +413,13 @@ namespace BPsimulation {
 		inline void set_connection_weight_one_way(size_t i, size_t j, double weight) {
 			auto [are_connected, idx] = get_neighbor_idx(i, j);
 			if (are_connected) {
-				weight_matrix[i][idx] = weight;
+				weight_at(i, idx) = weight;
 			} else {
+				throw_if_frozen("set_connection_weight_one_way");
+
+				sampling_tables_valid = false;
+				coloring_valid        = false;
+
 				connection_matrix[i].push_back(j);
 				weight_matrix[    i].push_back(weight);
 			}
@@ -115,9 +434,14 @@ namespace BPsimulation {
 		inline double increment_connection_weight_one_way(size_t i, size_t j, double weight) {
 			auto [are_connected, idx] = get_neighbor_idx(i, j);
 			if (are_connected) {
-				weight_matrix[i][idx] += weight;
-				return weight_matrix[i][idx];
+				weight_at(i, idx) += weight;
+				return weight_at(i, idx);
 			} else {
+				throw_if_frozen("increment_connection_weight_one_way");
+
+				sampling_tables_valid = false;
+				coloring_valid        = false;
+
 				connection_matrix[i].push_back(j);
 				weight_matrix[    i].push_back(weight);
 				return weight;
@@ -141,6 +465,11 @@ namespace BPsimulation {
 		}
 		inline void add_connection_single_way(size_t i, size_t j, double weight=1.d) {
 			if (!are_neighbors(i, j)) {
+				throw_if_frozen("add_connection_single_way");
+
+				sampling_tables_valid = false;
+				coloring_valid        = false;
+
 				connection_matrix[i].push_back(j);
 				weight_matrix[    i].push_back(weight);
 			}
@@ -157,6 +486,11 @@ namespace BPsimulation {
 		inline void remove_connection_single_way(size_t i, size_t j) {
 			auto [are_connected, idx] = get_neighbor_idx(i, j);
 			if (are_connected) {
+				throw_if_frozen("remove_connection_single_way");
+
+				sampling_tables_valid = false;
+				coloring_valid        = false;
+
 				connection_matrix[i].erase(connection_matrix[i].begin() + idx);
 				weight_matrix[    i].erase(weight_matrix[    i].begin() + idx);
 			}
@@ -166,6 +500,10 @@ namespace BPsimulation {
 			remove_connection_single_way(j, i);
 		}
 		inline void clear_connections(size_t i) {
+			throw_if_frozen("clear_connections");
+			sampling_tables_valid = false;
+			coloring_valid        = false;
+
 			connection_matrix[i].clear();
 			weight_matrix[    i].clear();
 		}
@@ -175,7 +513,11 @@ namespace BPsimulation {
 			}
 		}
 		inline void cleanup_connections(size_t i, double epsilon) {
-			for (long long int idx = weight_matrix.size()-1; idx > 0; --idx) {
+			throw_if_frozen("cleanup_connections");
+			sampling_tables_valid = false;
+			coloring_valid        = false;
+
+			for (long long int idx = weight_matrix[i].size()-1; idx >= 0; --idx) {
 				if (std::abs(weight_matrix[i][idx]) <= epsilon) {
 					connection_matrix[i].erase(connection_matrix[i].begin() + idx);
 					weight_matrix[    i].erase(weight_matrix[    i].begin() + idx);
@@ -191,6 +533,19 @@ namespace BPsimulation {
 		inline size_t degree(size_t node) const {
 			return neighbors(node).size();
 		}
+		inline size_t num_colors() {
+			if (!coloring_valid) {
+				build_coloring();
+			}
+			return color_order.size();
+		}
+		/* nodes of the given color, as updated together by interact_colored */
+		inline std::span<const uint32_t> color_class(size_t color) {
+			if (!coloring_valid) {
+				build_coloring();
+			}
+			return std::span<const uint32_t>(color_nodes.data() + color_offsets[color], color_offsets[color+1] - color_offsets[color]);
+		}
 		inline std::vector<size_t> degrees() const {
 			std::vector<size_t> degrees(num_nodes());
 			for (size_t node = 0; node < num_nodes(); ++node) {
@@ -199,107 +554,217 @@ namespace BPsimulation {
 			return degrees;
 		}
 
-		template<class Agent2>
-		inline void interact_serial(const core::agent::AgentInteractionFunctionTemplate<Agent2> *interactionfunc) {
+		/* the overloads taking a functor by reference are resolved at compile time, so functors
+		declared final (or any callable) get inlined into the node loops; the ones taking a pointer
+		to a polymorphic template are kept as the virtual fallback for plugin-style models */
+
+		template<class Func, class Agent2=core::agent::function_agent_type_t<Func, Agent>>
+			requires core::agent::AgentInteractionFunction<Func, Agent2>
+		inline void interact_serial(const Func &interactionfunc) {
 			static_assert(std::is_convertible<Agent, Agent2>::value, "Error: Agent class is not compatible with the one used by AgentInteractionFunctionTemplate in interact_serial !");
 
-			std::vector<size_t> node_lists = nodes();
-			std::shuffle(node_lists.begin(), node_lists.end(), util::get_random_generator());
+			update_sampling_tables(interactionfunc);
 
-			for (size_t node : node_lists) {
-				(*interactionfunc)((Agent2&)(*this)[node], get_neighbors<Agent2>(node));
+			if (node_order.size() != num_nodes()) {
+				node_order = nodes();
 			}
-		}
+			std::shuffle(node_order.begin(), node_order.end(), util::get_random_generator());
 
+			for (size_t node : node_order) {
+				interactionfunc((Agent2&)(*this)[node], get_neighbors<Agent2>(node));
+			}
+		}
 		template<class Agent2>
-		inline void interact_parallel(const core::agent::AgentInteractionFunctionTemplate<Agent2> *interactionfunc) {
+		inline void interact_serial(const core::agent::AgentInteractionFunctionTemplate<Agent2> *interactionfunc) {
+			interact_serial(*interactionfunc);
+		}
+
+		template<class Func, class Agent2=core::agent::function_agent_type_t<Func, Agent>>
+			requires core::agent::AgentInteractionFunction<Func, Agent2>
+		inline void interact_parallel(const Func &interactionfunc) {
 			static_assert(std::is_convertible<Agent, Agent2>::value, "Error: Agent class is not compatible with the one used by AgentInteractionFunctionTemplate in interact_parallel !");
 
+			update_sampling_tables(interactionfunc);
+
+			/* double buffering: the next state is written to placeholder while neighbors are read from
+			agent_vect, then both buffers are swapped. Assigning into the back buffer reuses its storage
+			(e.g. the proportions of AgentPopulation), so each step is a single pass over memory */
 			placeholder.resize(num_nodes());
 			#pragma omp parallel for
 			for (size_t node = 0; node < num_nodes(); ++node) {
-				placeholder[node] = (*this)[node];
+				placeholder[node] = agent_vect[node];
+				interactionfunc((Agent2&)placeholder[node], get_neighbors<Agent2>(node));
 			}
-			#pragma omp parallel for
-			for (size_t node = 0; node < num_nodes(); ++node) {
-				(*interactionfunc)((Agent2&)placeholder[node], get_neighbors<Agent2>(node));
+			agent_vect.swap(placeholder);
+		}
+		template<class Agent2>
+		inline void interact_parallel(const core::agent::AgentInteractionFunctionTemplate<Agent2> *interactionfunc) {
+			interact_parallel(*interactionfunc);
+		}
+
+		/* asynchronous (in-place) updates like interact_serial, but nodes are updated one color class
+		at a time: nodes of the same color never read each other, so each class is updated in parallel.
+		The order of the classes is shuffled at each step */
+		template<class Func, class Agent2=core::agent::function_agent_type_t<Func, Agent>>
+			requires core::agent::AgentInteractionFunction<Func, Agent2>
+		inline void interact_colored(const Func &interactionfunc) {
+			static_assert(std::is_convertible<Agent, Agent2>::value, "Error: Agent class is not compatible with the one used by AgentInteractionFunctionTemplate in interact_colored !");
+
+			update_sampling_tables(interactionfunc);
+
+			if (!coloring_valid) {
+				build_coloring();
 			}
-			#pragma omp parallel for
-			for (size_t node = 0; node < num_nodes(); ++node) {
-				(*this)[node] = placeholder[node];
+			std::shuffle(color_order.begin(), color_order.end(), util::get_random_generator());
+
+			for (size_t color : color_order) {
+				#pragma omp parallel for
+				for (size_t idx = color_offsets[color]; idx < color_offsets[color+1]; ++idx) {
+					size_t node = color_nodes[idx];
+					interactionfunc((Agent2&)agent_vect[node], get_neighbors<Agent2>(node));
+				}
 			}
 		}
-
 		template<class Agent2>
-		inline void interact(const core::agent::AgentInteractionFunctionTemplate<Agent2> *interactionfunc, bool parallel=false) {
-			static_assert(std::is_convertible<Agent, Agent2>::value, "Error: Agent class is not compatible with the one used by AgentInteractionFunctionTemplate in interact !");
+		inline void interact_colored(const core::agent::AgentInteractionFunctionTemplate<Agent2> *interactionfunc) {
+			interact_colored(*interactionfunc);
+		}
+
+		template<class Func, class Agent2=core::agent::function_agent_type_t<Func, Agent>>
+			requires core::agent::AgentInteractionFunction<Func, Agent2>
+		inline void interact(const Func &interactionfunc, bool parallel=false) {
 			if (parallel) {
 				interact_parallel(interactionfunc);
 			} else {
 				interact_serial(  interactionfunc);
 			}
 		}
-
 		template<class Agent2>
-		core::election::ElectionResultTemplate* get_election_results(const std::vector<size_t> &county, const core::election::ElectionTemplate<Agent2> *electionfunc) const {
-			static_assert(std::is_convertible<Agent, Agent2>::value, "Error: Agent class is not compatible with the one used by ElectionTemplate in ElectionResultTemplate !");
-
-			auto *result = electionfunc->get_neutral_election_result();
-			for (auto it = county.begin(); it != county.end(); ++it) {
-				(*result) += (*electionfunc)((Agent2&)(*this)[*it]);
-			}
+		inline void interact(const core::agent::AgentInteractionFunctionTemplate<Agent2> *interactionfunc, bool parallel=false) {
+			interact(*interactionfunc, parallel);
+		}
 
-			result->post_process();
-			return result;
+		template<class Func, class Agent2=core::agent::function_agent_type_t<Func, Agent>>
+			requires core::election::Election<Func, Agent2>
+		inline typename Func::result_type get_election_results(const std::vector<size_t> &county, const Func &electionfunc) const {
+			return get_election_results(std::span<const std::vector<size_t>>(&county, 1), electionfunc)[0];
 		}
 		template<class Agent2>
-		inline core::election::ElectionResultTemplate* get_election_results(const core::election::ElectionTemplate<Agent2> *electionfunc) const {
+		inline core::election::ElectionResultTemplate* get_election_results(const std::vector<size_t> &county, const core::election::ElectionTemplate<Agent2> *electionfunc) const {
+			return get_election_results(std::span<const std::vector<size_t>>(&county, 1), electionfunc)[0];
+		}
+		template<class Func, class Agent2=core::agent::function_agent_type_t<Func, Agent>>
+			requires core::election::Election<Func, Agent2>
+		inline typename Func::result_type get_election_results(const Func &electionfunc) const {
 			std::vector<size_t> node_lists = nodes();
 			return get_election_results(node_lists, electionfunc);
 		}
 		template<class Agent2>
-		inline std::vector<core::election::ElectionResultTemplate*> get_election_results(const std::vector<std::vector<size_t>> &counties, const core::election::ElectionTemplate<Agent2> *electionfunc) const {
+		inline core::election::ElectionResultTemplate* get_election_results(const core::election::ElectionTemplate<Agent2> *electionfunc) const {
+			std::vector<size_t> node_lists = nodes();
+			return get_election_results(node_lists, electionfunc);
+		}
+		template<class Func, class Agent2=core::agent::function_agent_type_t<Func, Agent>>
+			requires core::election::Election<Func, Agent2>
+		std::vector<typename Func::result_type> get_election_results(std::span<const std::vector<size_t>> counties, const Func &electionfunc) const {
 			static_assert(std::is_convertible<Agent, Agent2>::value, "Error: Agent class is not compatible with the one used by ElectionTemplate in get_election_results !");
 
-			std::vector<core::election::ElectionResultTemplate*> results(counties.size());
-			#pragma omp parallel for
-			for (size_t i = 0; i < counties.size(); ++i) {
-				results[i] = get_election_results(counties[i], electionfunc);
+			std::vector<typename Func::result_type> results = reduce_over_counties<typename Func::result_type>(counties,
+				[]() {
+					return typename Func::result_type();
+				},
+				[this, &electionfunc](typename Func::result_type &result, size_t node) {
+					electionfunc.accumulate(result, (const Agent2&)(*this)[node]);
+				},
+				[](typename Func::result_type &result, typename Func::result_type &other) {
+					result += other;
+				});
+
+			for (auto &result : results) {
+				result.post_process();
 			}
 			return results;
 		}
+		template<class Agent2>
+		std::vector<core::election::ElectionResultTemplate*> get_election_results(std::span<const std::vector<size_t>> counties, const core::election::ElectionTemplate<Agent2> *electionfunc) const {
+			static_assert(std::is_convertible<Agent, Agent2>::value, "Error: Agent class is not compatible with the one used by ElectionTemplate in get_election_results !");
 
+			std::vector<core::election::ElectionResultTemplate*> results = reduce_over_counties<core::election::ElectionResultTemplate*>(counties,
+				[electionfunc]() {
+					return electionfunc->get_neutral_election_result();
+				},
+				[this, electionfunc](core::election::ElectionResultTemplate *result, size_t node) {
+					electionfunc->accumulate(*result, (const Agent2&)(*this)[node]);
+				},
+				[](core::election::ElectionResultTemplate *result, core::election::ElectionResultTemplate *other) {
+					(*result) += other;
+					delete other;
+				});
+
+			for (auto *result : results) {
+				result->post_process();
+			}
+			return results;
+		}
+		template<class Func, class Agent2=core::agent::function_agent_type_t<Func, Agent>>
+			requires core::election::Election<Func, Agent2>
+		inline std::vector<typename Func::result_type> get_election_results(const std::vector<std::vector<size_t>> &counties, const Func &electionfunc) const {
+			return get_election_results(std::span<const std::vector<size_t>>(counties), electionfunc);
+		}
 		template<class Agent2>
-		void inline update_agentwise(const core::agent::AgentWiseUpdateFunctionTemplate<Agent2> *updatefunc) {
+		inline std::vector<core::election::ElectionResultTemplate*> get_election_results(const std::vector<std::vector<size_t>> &counties, const core::election::ElectionTemplate<Agent2> *electionfunc) const {
+			return get_election_results(std::span<const std::vector<size_t>>(counties), electionfunc);
+		}
+
+		template<class Func, class Agent2=core::agent::function_agent_type_t<Func, Agent>>
+			requires core::agent::AgentWiseUpdateFunction<Func, Agent2>
+		void inline update_agentwise(const Func &updatefunc) {
 			static_assert(std::is_convertible<Agent, Agent2>::value, "Error: Agent class is not compatible with the one used by AgentWiseUpdateFunctionTemplate in update_agentwise !");
 
 			#pragma omp parallel for
 			for (size_t node = 0; node < num_nodes(); ++node) {
-				(*updatefunc)((Agent2&)(*this)[node]);
+				updatefunc((Agent2&)(*this)[node]);
 			}
 		}
-
 		template<class Agent2>
-		void inline election_retroinfluence(const std::vector<size_t> &county, const core::election::ElectionResultTemplate *election_results, const core::election::ElectionRetroinfluenceTemplate<Agent2> *influencefunc) {
+		void inline update_agentwise(const core::agent::AgentWiseUpdateFunctionTemplate<Agent2> *updatefunc) {
+			update_agentwise(*updatefunc);
+		}
+
+		template<class Func, class Agent2=core::agent::function_agent_type_t<Func, Agent>>
+			requires core::election::ElectionRetroinfluence<Func, Agent2>
+		void inline election_retroinfluence(const std::vector<size_t> &county, const core::election::ElectionResultTemplate *election_results, const Func &influencefunc) {
 			static_assert(std::is_convertible<Agent, Agent2>::value, "Error: Agent class is not compatible with the one used by ElectionRetroinfluenceTemplate in election_retroinfluence !");
 
 			#pragma omp parallel for
-			for (size_t node : county) {
-				(*influencefunc)((Agent2&)(*this)[node], election_results);
+			for (size_t i = 0; i < county.size(); ++i) {
+				influencefunc((Agent2&)(*this)[county[i]], election_results);
 			}
 		}
 		template<class Agent2>
-		void inline election_retroinfluence(const core::election::ElectionResultTemplate *election_results, const core::election::ElectionRetroinfluenceTemplate<Agent2> *influencefunc) {
+		void inline election_retroinfluence(const std::vector<size_t> &county, const core::election::ElectionResultTemplate *election_results, const core::election::ElectionRetroinfluenceTemplate<Agent2> *influencefunc) {
+			election_retroinfluence(county, election_results, *influencefunc);
+		}
+		template<class Func, class Agent2=core::agent::function_agent_type_t<Func, Agent>>
+			requires core::election::ElectionRetroinfluence<Func, Agent2>
+		void inline election_retroinfluence(const core::election::ElectionResultTemplate *election_results, const Func &influencefunc) {
 			std::vector<size_t> node_lists = nodes();
 			return election_retroinfluence(node_lists, election_results, influencefunc);
 		}
 		template<class Agent2>
-		void inline election_retroinfluence(const std::vector<std::vector<size_t>> &counties, const std::vector<core::election::ElectionResultTemplate*> &election_results, const core::election::ElectionRetroinfluenceTemplate<Agent2> *influencefunc) {
+		void inline election_retroinfluence(const core::election::ElectionResultTemplate *election_results, const core::election::ElectionRetroinfluenceTemplate<Agent2> *influencefunc) {
+			election_retroinfluence(election_results, *influencefunc);
+		}
+		template<class Result, class Func, class Agent2=core::agent::function_agent_type_t<Func, Agent>>
+			requires core::election::ElectionRetroinfluence<Func, Agent2> && (
+				std::is_convertible<Result,  const core::election::ElectionResultTemplate*>::value ||
+				std::is_convertible<Result*, const core::election::ElectionResultTemplate*>::value)
+		void inline election_retroinfluence(const std::vector<std::vector<size_t>> &counties, const std::vector<Result> &election_results, const Func &influencefunc) {
 			static_assert(std::is_convertible<Agent,Agent2>::value, "Error: Agent class is not compatible with the one used by ElectionRetroinfluenceTemplate in election_retroinfluence !");
 
 			size_t max_2nd_loop_length = counties[0].size();
 			for (size_t i = 1; i < counties.size(); ++i) {
-				max_2nd_loop_length = std::max(max_2nd_loop_length, counties[1].size());
+				max_2nd_loop_length = std::max(max_2nd_loop_length, counties[i].size());
 			}
 
 			#pragma omp parallel for collapse(2)
@@ -307,7 +772,11 @@ namespace BPsimulation {
 				for (size_t j = 0; j < max_2nd_loop_length; ++j) {
 					if (j < counties[i].size()) {
 						size_t node = counties[i][j];
-						(*influencefunc)((Agent2&)(*this)[node], election_results[i]);
+						if constexpr (std::is_pointer<Result>::value) {
+							influencefunc((Agent2&)(*this)[node], election_results[i]);
+						} else {
+							influencefunc((Agent2&)(*this)[node], &election_results[i]);
+						}
 					}
 	#if !defined(_OPENMP)
 					else {
@@ -317,5 +786,9 @@ namespace BPsimulation {
 				}
 			}
 		}
+		template<class Agent2>
+		void inline election_retroinfluence(const std::vector<std::vector<size_t>> &counties, const std::vector<core::election::ElectionResultTemplate*> &election_results, const core::election::ElectionRetroinfluenceTemplate<Agent2> *influencefunc) {
+			election_retroinfluence(counties, election_results, *influencefunc);
+		}
 	};
 }
\ No newline at end of file
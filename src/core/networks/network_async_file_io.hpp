@@ -0,0 +1,161 @@
+#pragma once
+
+#include "network_file_io.hpp"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <iostream>
+
+
+namespace BPsimulation::io {
+	/* background output stage for agent state trajectories: push copies the agent states into columns and queues them,
+	a dedicated thread drains the queue into an AgentStatesTrajectoryWriter so the simulation can keep stepping.
+	The queue is bounded by max_buffered_bytes (a single snapshot is always accepted), push blocking until there is room.
+	The HDF5 library has to be threadsafe (the constructor throws otherwise), as HDF5 calls made by the simulation
+	(on any file) would run concurrently with the writer thread. The trajectory file itself must still not be accessed
+	until flush returns or the writer is destroyed.
+	If writing a snapshot fails, the trajectory is left inconsistent: the queued snapshots are dropped, nothing more is written,
+	and the error is rethrown by every following push or flush (or reported by the destructor if it never was) */
+	template<class Agent2>
+	class AsyncAgentStatesWriter {
+	private:
+		typedef core::agent::AgentSerializerTemplate<Agent2> serializer_type;
+		typedef typename serializer_type::column_type        column_type;
+
+		const serializer_type               *serializer;
+		AgentStatesTrajectoryWriter<Agent2>  writer;
+		size_t                               max_buffered_bytes, buffered_bytes = 0;
+
+		std::deque<std::pair<std::vector<column_type>, size_t>> queue;
+		bool                                                    writing = false, stopping = false;
+		std::exception_ptr                                      writer_exception;
+		bool                                                    writer_exception_reported = false;
+
+		std::mutex              mutex;
+		std::condition_variable queue_changed;
+		std::thread             writer_thread;
+
+		static size_t get_num_bytes(const std::vector<column_type> &columns) {
+			size_t num_bytes = 0;
+			for (const column_type &column : columns) {
+				num_bytes += std::visit([](const auto &column_) {
+					return column_.size()*sizeof(typename std::decay_t<decltype(column_)>::value_type);
+				}, column);
+			}
+			return num_bytes;
+		}
+
+		void rethrow_if_failed() {
+			if (writer_exception) {
+				writer_exception_reported = true;
+				std::rethrow_exception(writer_exception);
+			}
+		}
+		static const serializer_type *throw_if_not_threadsafe(const serializer_type *serializer_) {
+			hbool_t is_threadsafe = false;
+			if (H5is_library_threadsafe(&is_threadsafe) < 0 || !is_threadsafe) {
+				throw std::runtime_error("in \"AsyncAgentStatesWriter\", the HDF5 library isn't threadsafe");
+			}
+			return serializer_;
+		}
+		void drop_queue() {
+			queue.clear();
+			buffered_bytes = 0;
+		}
+
+		void drain() {
+			std::unique_lock<std::mutex> lock(mutex);
+			for (;;) {
+				queue_changed.wait(lock, [this]() { return stopping || !queue.empty(); });
+				if (queue.empty()) {
+					return;
+				}
+
+				std::pair<std::vector<column_type>, size_t> snapshot = std::move(queue.front());
+				queue.pop_front();
+				writing = true;
+
+				lock.unlock();
+				std::exception_ptr exception;
+				try {
+					writer.append_columns(snapshot.first);
+				} catch (...) {
+					exception = std::current_exception();
+				}
+				lock.lock();
+
+				writing         = false;
+				buffered_bytes -= snapshot.second;
+				if (exception) {
+					writer_exception = exception;
+					drop_queue();
+				}
+				queue_changed.notify_all();
+			}
+		}
+
+	public:
+		AsyncAgentStatesWriter(const serializer_type *serializer_, H5::H5File &file, size_t num_nodes, size_t max_buffered_bytes_=(size_t)1 << 30,
+			const char* group_name="/states_trajectory", const util::hdf5io::H5ChunkOptions &options={}) :
+			serializer(throw_if_not_threadsafe(serializer_)), writer(serializer_, file, num_nodes, group_name, options), max_buffered_bytes(max_buffered_bytes_)
+		{
+			writer_thread = std::thread(&AsyncAgentStatesWriter::drain, this);
+		}
+		AsyncAgentStatesWriter(const AsyncAgentStatesWriter&) = delete;
+		AsyncAgentStatesWriter& operator=(const AsyncAgentStatesWriter&) = delete;
+		~AsyncAgentStatesWriter() {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				stopping = true;
+			}
+			queue_changed.notify_all();
+			writer_thread.join();
+
+			if (writer_exception && !writer_exception_reported) {
+				try {
+					std::rethrow_exception(writer_exception);
+				} catch (const std::exception &exception) {
+					std::cerr << "AsyncAgentStatesWriter: failed to write a snapshot, trajectory left incomplete: " << exception.what() << "\n";
+				} catch (...) {
+					std::cerr << "AsyncAgentStatesWriter: failed to write a snapshot, trajectory left incomplete\n";
+				}
+			}
+		}
+
+		template<class Agent>
+		void push(const SocialNetwork<Agent> *network) {
+			if (network->num_nodes() != writer.num_nodes()) {
+				throw std::invalid_argument("in \"AsyncAgentStatesWriter::push\", number of nodes doesn't match the trajectory");
+			}
+
+			push_columns(write_agent_states_to_columns(network, serializer));
+		}
+		void push_columns(std::vector<column_type> &&columns) {
+			const size_t num_bytes = get_num_bytes(columns);
+
+			std::unique_lock<std::mutex> lock(mutex);
+			queue_changed.wait(lock, [&]() {
+				return writer_exception || buffered_bytes == 0 || buffered_bytes + num_bytes <= max_buffered_bytes;
+			});
+			rethrow_if_failed();
+
+			buffered_bytes += num_bytes;
+			queue.emplace_back(std::move(columns), num_bytes);
+			queue_changed.notify_all();
+		}
+
+		/* waits until every queued snapshot has been written, and flushes the file */
+		void flush(H5::H5File &file) {
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				queue_changed.wait(lock, [this]() { return queue.empty() && !writing; });
+				rethrow_if_failed();
+			}
+
+			H5Fflush(file.getId(), H5F_SCOPE_LOCAL);
+		}
+	};
+}
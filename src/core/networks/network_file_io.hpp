@@ -13,131 +13,234 @@ namespace BPsimulation::io {
 	void write_network_to_file(const SocialNetwork<Agent> *network, H5::H5File &file, const char* group_name="/network") {
 		H5::Group group = file.createGroup(group_name);
 
-		std::vector<std::vector<size_t>> neighbors;
+		std::vector<size_t> begin_end_idx(network->num_nodes()+1, 0);
 		for (size_t node = 0; node < network->num_nodes(); ++node) {
-			neighbors.push_back(network->neighbors(node));
+			begin_end_idx[node+1] = begin_end_idx[node] + network->degree(node);
 		}
-		util::hdf5io::H5WriteIrregular2DVector(group, neighbors, "neighbors");
+
+		std::vector<uint32_t> neighbors(begin_end_idx.back());
+		#pragma omp parallel for
+		for (size_t node = 0; node < network->num_nodes(); ++node) {
+			std::span<const uint32_t> node_neighbors = network->neighbors(node);
+			std::copy(node_neighbors.begin(), node_neighbors.end(), neighbors.begin() + begin_end_idx[node]);
+		}
+		util::hdf5io::H5WriteFlattened2DVector(group, begin_end_idx, neighbors, "neighbors");
 
 		group.close();
 	}
+
+	/* resizes the network and moves in a flattened adjacency, all connections having a weight of 1 */
 	template<class Agent>
-	auto read_network_from_file(SocialNetwork<Agent> *network, H5::H5File &file, const char* group_name="/network") {
-		H5::Group group = file.openGroup(group_name);
+	void assign_network_connections(SocialNetwork<Agent> *network, std::vector<size_t> &&begin_end_idx, std::vector<uint32_t> &&neighbors) {
+		if (begin_end_idx.empty()) {
+			throw std::invalid_argument("in \"assign_network_connections\", begin_end_idx can't be empty");
+		}
+		const size_t num_nodes = begin_end_idx.size()-1;
 
-		std::vector<std::vector<size_t>> neighbors(0, std::vector<size_t>(0));
-		util::hdf5io::H5ReadIrregular2DVector(group, neighbors, "neighbors");
+		bool out_of_range = false;
+		#pragma omp parallel for reduction(||:out_of_range)
+		for (size_t i = 0; i < neighbors.size(); ++i) {
+			out_of_range = out_of_range || neighbors[i] >= num_nodes;
+		}
+		if (out_of_range) {
+			throw std::invalid_argument("in \"assign_network_connections\", neighbor index out of range");
+		}
 
-		network->resize(neighbors.size());
-		network->clear_connections();
+		if (network->num_nodes() != num_nodes) {
+			bool was_frozen = network->is_frozen();
+			network->thaw();
 
-		for (size_t node = 0; node < network->num_nodes(); ++node) {
-			for (size_t neighbor : neighbors[node]) {
-				network->add_connection_single_way(node, neighbor);
+			network->clear_connections();
+			network->resize(num_nodes);
+
+			if (was_frozen) {
+				network->freeze();
 			}
 		}
 
+		std::vector<double> weights(neighbors.size(), 1.d);
+		network->assign_connections(std::move(begin_end_idx), std::move(neighbors), std::move(weights));
+	}
+
+	/* bulk loader: the adjacency is built directly from the flattened neighbors and begin_end_idx arrays,
+	without checking for duplicated connections */
+	template<class Agent>
+	void read_network_from_file(SocialNetwork<Agent> *network, H5::H5File &file, const char* group_name="/network") {
+		H5::Group group = file.openGroup(group_name);
+
+		std::vector<size_t>   begin_end_idx;
+		std::vector<uint32_t> neighbors;
+		util::hdf5io::H5ReadVector(group, begin_end_idx, "neighbors_begin_end_idx");
+		util::hdf5io::H5ReadVector(group, neighbors,     "neighbors");
+
 		group.close();
+
+		assign_network_connections(network, std::move(begin_end_idx), std::move(neighbors));
+	}
+
+	/* sharded layout: shard i of num_shards holds a contiguous range of nodes, so that each rank can write
+	and read its own partition in its own file (or group) */
+	inline std::pair<size_t, size_t> get_shard_range(size_t num_nodes, size_t shard, size_t num_shards) {
+		return {
+			num_nodes*shard    /num_shards,
+			num_nodes*(shard+1)/num_shards
+		};
 	}
 
+	struct NetworkShard {
+		size_t                num_nodes = 0, begin = 0, end = 0;
+		std::vector<size_t>   begin_end_idx;
+		std::vector<uint32_t> neighbors;
+	};
+
+	template<class Agent>
+	void write_network_shard_to_file(const SocialNetwork<Agent> *network, H5::H5File &file, size_t shard, size_t num_shards, const char* group_name="/network") {
+		H5::Group group = file.createGroup(group_name);
+
+		auto [begin, end] = get_shard_range(network->num_nodes(), shard, num_shards);
 
+		std::vector<size_t> begin_end_idx(end-begin+1, 0);
+		for (size_t node = begin; node < end; ++node) {
+			begin_end_idx[node-begin+1] = begin_end_idx[node-begin] + network->degree(node);
+		}
+
+		std::vector<uint32_t> neighbors(begin_end_idx.back());
+		#pragma omp parallel for
+		for (size_t node = begin; node < end; ++node) {
+			std::span<const uint32_t> node_neighbors = network->neighbors(node);
+			std::copy(node_neighbors.begin(), node_neighbors.end(), neighbors.begin() + begin_end_idx[node-begin]);
+		}
+
+		util::hdf5io::H5WriteSingle<size_t>(group, network->num_nodes(), "num_nodes");
+		util::hdf5io::H5WriteSingle<size_t>(group, begin,                "shard_begin");
+		util::hdf5io::H5WriteFlattened2DVector(group, begin_end_idx, neighbors, "neighbors");
+
+		group.close();
+	}
+	inline NetworkShard read_network_shard_from_file(H5::H5File &file, const char* group_name="/network") {
+		H5::Group group = file.openGroup(group_name);
+
+		NetworkShard shard;
+		shard.num_nodes = util::hdf5io::H5ReadSingle<size_t>(group, "num_nodes");
+		shard.begin     = util::hdf5io::H5ReadSingle<size_t>(group, "shard_begin");
+		util::hdf5io::H5ReadVector(group, shard.begin_end_idx, "neighbors_begin_end_idx");
+		util::hdf5io::H5ReadVector(group, shard.neighbors,     "neighbors");
+		shard.end = shard.begin + shard.begin_end_idx.size()-1;
+
+		group.close();
+
+		return shard;
+	}
+	/* rebuilds the whole network from all of its shards (in any order), concatenating them in parallel */
+	template<class Agent>
+	void read_network_from_shards(SocialNetwork<Agent> *network, std::span<H5::H5File> files, const char* group_name="/network") {
+		std::vector<NetworkShard> shards(files.size());
+		for (size_t i = 0; i < files.size(); ++i) {
+			shards[i] = read_network_shard_from_file(files[i], group_name);
+		}
+		std::sort(shards.begin(), shards.end(), [](const NetworkShard &shard1, const NetworkShard &shard2) {
+			return shard1.begin < shard2.begin;
+		});
+
+		const size_t num_nodes = shards.empty() ? 0 : shards[0].num_nodes;
+
+		std::vector<size_t> shard_offsets(shards.size()+1, 0);
+		for (size_t i = 0; i < shards.size(); ++i) {
+			if (shards[i].num_nodes != num_nodes || shards[i].begin != (i == 0 ? 0 : shards[i-1].end)) {
+				throw std::invalid_argument("in \"read_network_from_shards\", shards don't cover the network");
+			}
+			shard_offsets[i+1] = shard_offsets[i] + shards[i].neighbors.size();
+		}
+		if (!shards.empty() && shards.back().end != num_nodes) {
+			throw std::invalid_argument("in \"read_network_from_shards\", shards don't cover the network");
+		}
+
+		std::vector<size_t>   begin_end_idx(num_nodes+1, 0);
+		std::vector<uint32_t> neighbors(shard_offsets.back());
+		#pragma omp parallel for
+		for (size_t i = 0; i < shards.size(); ++i) {
+			for (size_t node = shards[i].begin; node < shards[i].end; ++node) {
+				begin_end_idx[node+1] = shard_offsets[i] + shards[i].begin_end_idx[node-shards[i].begin+1];
+			}
+			std::copy(shards[i].neighbors.begin(), shards[i].neighbors.end(), neighbors.begin() + shard_offsets[i]);
+		}
+
+		assign_network_connections(network, std::move(begin_end_idx), std::move(neighbors));
+	}
+
+
+	/* one column per field of the serializer, filled in a single (parallel) pass over the agents [begin, end) */
 	template<class Agent, class Agent2>
-	void write_agent_states_to_file(const SocialNetwork<Agent> *network, const core::agent::AgentSerializerTemplate<Agent2> *serializer,
-		H5::H5File &file, const char* group_name="/states")
+	std::vector<typename core::agent::AgentSerializerTemplate<Agent2>::column_type> write_agent_states_to_columns(const SocialNetwork<Agent> *network,
+		const core::agent::AgentSerializerTemplate<Agent2> *serializer, size_t begin=0, size_t end=(size_t)-1)
 	{
-		static_assert(std::is_convertible<Agent, Agent2>::value, "Error: Agent class is not compatible with the one used by AgentSerializerTemplate in read_agent_states_from_file !");
+		static_assert(std::is_convertible<Agent, Agent2>::value, "Error: Agent class is not compatible with the one used by AgentSerializerTemplate in write_agent_states_to_columns !");
 
-		H5::Group group = file.createGroup(group_name);
+		using serializer_type = core::agent::AgentSerializerTemplate<Agent2>;
 
-		using variable_type = std::variant<bool, int, unsigned int, long, size_t, float, double>;
-		using vector_variable_type = std::variant<
-			std::vector<char>, std::vector<int>,    std::vector<unsigned int>,
-			std::vector<long>, std::vector<size_t>, std::vector<float>,
-			std::vector<double>>;
+		end = std::min(end, network->num_nodes());
 
-		std::vector<std::pair<std::string, int>> list_of_fields = serializer->list_of_fields();
-		std::vector<vector_variable_type> write_vectors(list_of_fields.size());
+		std::vector<typename serializer_type::column_type> columns = serializer->make_columns(end-begin);
 
-		for (size_t ifield = 0; ifield < list_of_fields.size(); ++ifield) {
-			switch (list_of_fields[ifield].second) {
-			case 0:
-				write_vectors[ifield] = std::vector<char>(        network->num_nodes());
-				break;
-			case 1:
-				write_vectors[ifield] = std::vector<int>(         network->num_nodes());
-				break;
-			case 2:
-				write_vectors[ifield] = std::vector<unsigned int>(network->num_nodes());
-				break;
-			case 3:
-				write_vectors[ifield] = std::vector<long>(        network->num_nodes());
-				break;
-			case 4:
-				write_vectors[ifield] = std::vector<size_t>(      network->num_nodes());
-				break;
-			case 5:
-				write_vectors[ifield] = std::vector<float>(       network->num_nodes());
-				break;
-			case 6:
-				write_vectors[ifield] = std::vector<double>(      network->num_nodes());
-				break;
+		if constexpr (std::is_same<Agent, Agent2>::value) {
+			serializer->write_columns(network->agents().subspan(begin, end-begin), columns);
+		} else {
+			#pragma omp parallel for
+			for (size_t node = begin; node < end; ++node) {
+				std::vector<typename serializer_type::variable_type> values = serializer->write((const Agent2&)(*network)[node]);
+				for (size_t ifield = 0; ifield < columns.size(); ++ifield) {
+					serializer_type::set_column_value(columns[ifield], node-begin, values[ifield]);
+				}
 			}
 		}
 
-		for (size_t node = 0; node < network->num_nodes(); ++node) {
-			std::vector<variable_type> values = serializer->write((Agent2&)(*network)[node]);
+		return columns;
+	}
+	/* reads the columns into the agents starting at node begin */
+	template<class Agent, class Agent2>
+	void read_agent_states_from_columns(SocialNetwork<Agent> *network, const core::agent::AgentSerializerTemplate<Agent2> *serializer,
+		const std::vector<typename core::agent::AgentSerializerTemplate<Agent2>::column_type> &columns, size_t begin=0)
+	{
+		static_assert(std::is_convertible<Agent2, Agent>::value, "Error: Agent class is not compatible with the one used by AgentSerializerTemplate in read_agent_states_from_columns !");
 
-			for (size_t ifield = 0; ifield < list_of_fields.size(); ++ifield) {
-				switch (list_of_fields[ifield].second) {
-				case 0:
-					group, std::get<0>(write_vectors[ifield])[node] = (char)std::get<0>(values[ifield]);
-					break;
-				case 1:
-					group, std::get<1>(write_vectors[ifield])[node] = std::get<1>(values[ifield]);
-					break;
-				case 2:
-					group, std::get<2>(write_vectors[ifield])[node] = std::get<2>(values[ifield]);
-					break;
-				case 3:
-					group, std::get<3>(write_vectors[ifield])[node] = std::get<3>(values[ifield]);
-					break;
-				case 4:
-					group, std::get<4>(write_vectors[ifield])[node] = std::get<4>(values[ifield]);
-					break;
-				case 5:
-					group, std::get<5>(write_vectors[ifield])[node] = std::get<5>(values[ifield]);
-					break;
-				case 6:
-					group, std::get<6>(write_vectors[ifield])[node] = std::get<6>(values[ifield]);
-					break;
+		using serializer_type = core::agent::AgentSerializerTemplate<Agent2>;
+
+		const size_t num_agents = columns.empty() ? 0 : std::visit([](const auto &column) { return column.size(); }, columns[0]);
+		if (begin + num_agents > network->num_nodes()) {
+			throw std::invalid_argument("in \"read_agent_states_from_columns\", columns don't fit in the network");
+		}
+
+		if constexpr (std::is_same<Agent, Agent2>::value) {
+			serializer->read_columns(network->agents().subspan(begin, num_agents), columns);
+		} else {
+			#pragma omp parallel
+			{
+				std::vector<typename serializer_type::variable_type> values(columns.size());
+
+				#pragma omp for
+				for (size_t node = 0; node < num_agents; ++node) {
+					for (size_t ifield = 0; ifield < columns.size(); ++ifield) {
+						values[ifield] = serializer_type::get_column_value(columns[ifield], node);
+					}
+					serializer->read((Agent2&)(*network)[begin+node], values);
 				}
 			}
 		}
+	}
+
+	template<class Agent, class Agent2>
+	void write_agent_states_to_file(const SocialNetwork<Agent> *network, const core::agent::AgentSerializerTemplate<Agent2> *serializer,
+		H5::H5File &file, const char* group_name="/states")
+	{
+		H5::Group group = file.createGroup(group_name);
+
+		std::vector<std::pair<std::string, int>> list_of_fields = serializer->list_of_fields();
+		auto                                     columns        = write_agent_states_to_columns(network, serializer);
 
 		for (size_t ifield = 0; ifield < list_of_fields.size(); ++ifield) {
-			switch (list_of_fields[ifield].second) {
-			case 0:
-				util::hdf5io::H5WriteVector<char>(        group, std::get<0>(write_vectors[ifield]), list_of_fields[ifield].first.c_str());
-				break;
-			case 1:
-				util::hdf5io::H5WriteVector<int>(         group, std::get<1>(write_vectors[ifield]), list_of_fields[ifield].first.c_str());
-				break;
-			case 2:
-				util::hdf5io::H5WriteVector<unsigned int>(group, std::get<2>(write_vectors[ifield]), list_of_fields[ifield].first.c_str());
-				break;
-			case 3:
-				util::hdf5io::H5WriteVector<long>(        group, std::get<3>(write_vectors[ifield]), list_of_fields[ifield].first.c_str());
-				break;
-			case 4:
-				util::hdf5io::H5WriteVector<size_t>(      group, std::get<4>(write_vectors[ifield]), list_of_fields[ifield].first.c_str());
-				break;
-			case 5:
-				util::hdf5io::H5WriteVector<float>(       group, std::get<5>(write_vectors[ifield]), list_of_fields[ifield].first.c_str());
-				break;
-			case 6:
-				util::hdf5io::H5WriteVector<double>(      group, std::get<6>(write_vectors[ifield]), list_of_fields[ifield].first.c_str());
-				break;
-			}
+			std::visit([&](const auto &column) {
+				util::hdf5io::H5WriteVector(group, column, list_of_fields[ifield].first.c_str());
+			}, columns[ifield]);
 		}
 
 		group.close();
@@ -147,86 +250,171 @@ namespace BPsimulation::io {
 	void read_agent_states_from_file(SocialNetwork<Agent> *network, const core::agent::AgentSerializerTemplate<Agent2> *serializer,
 		H5::H5File &file, const char* group_name="/states")
 	{
-		static_assert(std::is_convertible<Agent2, Agent>::value, "Error: Agent class is not compatible with the one used by AgentSerializerTemplate in read_agent_states_from_file !");
-
 		H5::Group group = file.openGroup(group_name);
 
-		using variable_type = std::variant<bool, int, unsigned int, long, size_t, float, double>;
-		using vector_variable_type = std::variant<
-			std::vector<char>, std::vector<int>,    std::vector<unsigned int>,
-			std::vector<long>, std::vector<size_t>, std::vector<float>,
-			std::vector<double>>;
+		std::vector<std::pair<std::string, int>> list_of_fields = serializer->list_of_fields();
+		auto                                     columns        = serializer->make_columns(0);
+
+		for (size_t ifield = 0; ifield < list_of_fields.size(); ++ifield) {
+			std::visit([&](auto &column) {
+				util::hdf5io::H5ReadVector(group, column, list_of_fields[ifield].first.c_str());
+			}, columns[ifield]);
+		}
+
+		read_agent_states_from_columns(network, serializer, columns);
+
+		group.close();
+	}
+
+
+	template<class Agent, class Agent2>
+	void write_agent_states_shard_to_file(const SocialNetwork<Agent> *network, const core::agent::AgentSerializerTemplate<Agent2> *serializer,
+		H5::H5File &file, size_t shard, size_t num_shards, const char* group_name="/states")
+	{
+		H5::Group group = file.createGroup(group_name);
+
+		auto [begin, end] = get_shard_range(network->num_nodes(), shard, num_shards);
 
 		std::vector<std::pair<std::string, int>> list_of_fields = serializer->list_of_fields();
-		std::vector<vector_variable_type> read_vectors(list_of_fields.size());
+		auto                                     columns        = write_agent_states_to_columns(network, serializer, begin, end);
 
+		util::hdf5io::H5WriteSingle<size_t>(group, begin, "shard_begin");
 		for (size_t ifield = 0; ifield < list_of_fields.size(); ++ifield) {
-			switch (list_of_fields[ifield].second) {
-			case 0:
-				read_vectors[ifield] = std::vector<char>();
-				util::hdf5io::H5ReadVector<char>(        group, std::get<0>(read_vectors[ifield]), list_of_fields[ifield].first.c_str());
-				break;
-			case 1:
-				read_vectors[ifield] = std::vector<int>();
-				util::hdf5io::H5ReadVector<int>(         group, std::get<1>(read_vectors[ifield]), list_of_fields[ifield].first.c_str());
-				break;
-			case 2:
-				read_vectors[ifield] = std::vector<unsigned int>();
-				util::hdf5io::H5ReadVector<unsigned int>(group, std::get<2>(read_vectors[ifield]), list_of_fields[ifield].first.c_str());
-				break;
-			case 3:
-				read_vectors[ifield] = std::vector<long>();
-				util::hdf5io::H5ReadVector<long>(        group, std::get<3>(read_vectors[ifield]), list_of_fields[ifield].first.c_str());
-				break;
-			case 4:
-				read_vectors[ifield] = std::vector<size_t>();
-				util::hdf5io::H5ReadVector<size_t>(      group, std::get<4>(read_vectors[ifield]), list_of_fields[ifield].first.c_str());
-				break;
-			case 5:
-				read_vectors[ifield] = std::vector<float>();
-				util::hdf5io::H5ReadVector<float>(       group, std::get<5>(read_vectors[ifield]), list_of_fields[ifield].first.c_str());
-				break;
-			case 6:
-				read_vectors[ifield] = std::vector<double>();
-				util::hdf5io::H5ReadVector<double>(      group, std::get<6>(read_vectors[ifield]), list_of_fields[ifield].first.c_str());
-				break;
+			std::visit([&](const auto &column) {
+				util::hdf5io::H5WriteVector(group, column, list_of_fields[ifield].first.c_str());
+			}, columns[ifield]);
+		}
+
+		group.close();
+	}
+	/* reads a shard of agent states into its node range, the network having to be already sized */
+	template<class Agent, class Agent2>
+	void read_agent_states_shard_from_file(SocialNetwork<Agent> *network, const core::agent::AgentSerializerTemplate<Agent2> *serializer,
+		H5::H5File &file, const char* group_name="/states")
+	{
+		H5::Group group = file.openGroup(group_name);
+
+		std::vector<std::pair<std::string, int>> list_of_fields = serializer->list_of_fields();
+		auto                                     columns        = serializer->make_columns(0);
+
+		const size_t begin = util::hdf5io::H5ReadSingle<size_t>(group, "shard_begin");
+		for (size_t ifield = 0; ifield < list_of_fields.size(); ++ifield) {
+			std::visit([&](auto &column) {
+				util::hdf5io::H5ReadVector(group, column, list_of_fields[ifield].first.c_str());
+			}, columns[ifield]);
+		}
+
+		group.close();
+
+		read_agent_states_from_columns(network, serializer, columns, begin);
+	}
+
+
+	/* appends agent state snapshots to one extensible (time, node) dataset per field,
+	instead of creating a group per snapshot. Reopening an existing trajectory group appends to it */
+	template<class Agent2>
+	class AgentStatesTrajectoryWriter {
+	protected:
+		typedef core::agent::AgentSerializerTemplate<Agent2> serializer_type;
+
+		const serializer_type                   *serializer;
+
+	private:
+		H5::Group                                group;
+		std::vector<std::pair<std::string, int>> list_of_fields;
+		std::vector<H5::DataSet>                 datasets;
+		size_t                                   num_nodes_, num_timesteps_ = 0;
+
+	public:
+		AgentStatesTrajectoryWriter(const serializer_type *serializer_, H5::H5File &file, size_t num_nodes,
+			const char* group_name="/states_trajectory", const util::hdf5io::H5ChunkOptions &options={}) :
+			serializer(serializer_), list_of_fields(serializer_->list_of_fields()), num_nodes_(num_nodes)
+		{
+			if (H5Lexists(file.getId(), group_name, H5P_DEFAULT) > 0) {
+				group = file.openGroup(group_name);
+
+				for (size_t ifield = 0; ifield < list_of_fields.size(); ++ifield) {
+					datasets.push_back(group.openDataSet(list_of_fields[ifield].first.c_str()));
+				}
+				num_timesteps_ = util::hdf5io::H5NumRows(group, list_of_fields[0].first.c_str());
+			} else {
+				group = file.createGroup(group_name);
+
+				std::vector<typename serializer_type::column_type> columns = serializer->make_columns(0);
+				for (size_t ifield = 0; ifield < list_of_fields.size(); ++ifield) {
+					datasets.push_back(std::visit([&](const auto &column) {
+						typedef typename std::decay_t<decltype(column)>::value_type Type;
+						return util::hdf5io::H5CreateExtensible2D<Type>(group, num_nodes_, list_of_fields[ifield].first.c_str(), options);
+					}, columns[ifield]));
+				}
 			}
 		}
+		inline size_t num_nodes() const {
+			return num_nodes_;
+		}
+		inline size_t num_timesteps() const {
+			return num_timesteps_;
+		}
 
-		std::vector<variable_type> values(list_of_fields.size());
-		for (size_t node = 0; node < network->num_nodes(); ++node) {
+		void append_columns(const std::vector<typename serializer_type::column_type> &columns) {
 			for (size_t ifield = 0; ifield < list_of_fields.size(); ++ifield) {
-				switch (list_of_fields[ifield].second) {
-				case 0:
-					values[ifield] = (bool)std::get<0>(read_vectors[ifield])[node];
-					break;
-				case 1:
-					values[ifield] = std::get<1>(read_vectors[ifield])[node];
-					break;
-				case 2:
-					values[ifield] = std::get<2>(read_vectors[ifield])[node];
-					break;
-				case 3:
-					values[ifield] = std::get<3>(read_vectors[ifield])[node];
-					break;
-				case 4:
-					values[ifield] = std::get<4>(read_vectors[ifield])[node];
-					break;
-				case 5:
-					values[ifield] = std::get<5>(read_vectors[ifield])[node];
-					break;
-				case 6:
-					values[ifield] = std::get<6>(read_vectors[ifield])[node];
-					break;
-				}
+				std::visit([&](const auto &column) {
+					util::hdf5io::H5AppendRow(datasets[ifield], column);
+				}, columns[ifield]);
+			}
+			++num_timesteps_;
+		}
+		template<class Agent>
+		void append(const SocialNetwork<Agent> *network) {
+			if (network->num_nodes() != num_nodes_) {
+				throw std::invalid_argument("in \"AgentStatesTrajectoryWriter::append\", number of nodes doesn't match the trajectory");
 			}
 
-			serializer->read((Agent2&)(*network)[node], values);
+			append_columns(write_agent_states_to_columns(network, serializer));
+		}
+	};
+
+	template<class Agent, class Agent2>
+	void read_agent_states_timestep_from_file(SocialNetwork<Agent> *network, const core::agent::AgentSerializerTemplate<Agent2> *serializer,
+		H5::H5File &file, size_t timestep, const char* group_name="/states_trajectory")
+	{
+		H5::Group group = file.openGroup(group_name);
+
+		std::vector<std::pair<std::string, int>> list_of_fields = serializer->list_of_fields();
+		auto                                     columns        = serializer->make_columns(0);
+
+		for (size_t ifield = 0; ifield < list_of_fields.size(); ++ifield) {
+			std::visit([&](auto &column) {
+				util::hdf5io::H5ReadRow(group, column, list_of_fields[ifield].first.c_str(), timestep);
+			}, columns[ifield]);
 		}
 
+		read_agent_states_from_columns(network, serializer, columns);
+
 		group.close();
 	}
 
+	/* history of a single node: one column per field, holding its value at each timestep */
+	template<class Agent2>
+	std::vector<typename core::agent::AgentSerializerTemplate<Agent2>::column_type> read_agent_state_history_from_file(
+		const core::agent::AgentSerializerTemplate<Agent2> *serializer, H5::H5File &file, size_t node, const char* group_name="/states_trajectory")
+	{
+		H5::Group group = file.openGroup(group_name);
+
+		std::vector<std::pair<std::string, int>> list_of_fields = serializer->list_of_fields();
+		auto                                     columns        = serializer->make_columns(0);
+
+		for (size_t ifield = 0; ifield < list_of_fields.size(); ++ifield) {
+			std::visit([&](auto &column) {
+				util::hdf5io::H5ReadColumn(group, column, list_of_fields[ifield].first.c_str(), node);
+			}, columns[ifield]);
+		}
+
+		group.close();
+
+		return columns;
+	}
+
 
 	void write_counties_to_file(const std::vector<std::vector<size_t>> &counties, H5::H5File &file, const char* group_name="/counties") {
 		H5::Group group = file.createGroup(group_name);
@@ -282,16 +470,106 @@ namespace BPsimulation::io {
 		group.close();
 	}
 
-	void write_election_results_to_file(const std::vector<core::election::ElectionResultTemplate*> &results, const core::election::ElectionResultSerializerTemplate *serializer,
+	/* one column per field of the serializer, holding its value for each county */
+	inline std::vector<core::election::ElectionResultSerializerTemplate::column_type> write_election_results_to_columns(
+		const std::vector<core::election::ElectionResultTemplate*> &results, const core::election::ElectionResultSerializerTemplate *serializer)
+	{
+		using serializer_type = core::election::ElectionResultSerializerTemplate;
+
+		std::vector<serializer_type::column_type> columns = serializer->make_columns(results.size());
+
+		#pragma omp parallel for
+		for (size_t i = 0; i < results.size(); ++i) {
+			std::vector<serializer_type::variable_type> values = serializer->write(*results[i]);
+			for (size_t ifield = 0; ifield < columns.size(); ++ifield) {
+				serializer_type::set_column_value(columns[ifield], i, values[ifield]);
+			}
+		}
+
+		return columns;
+	}
+
+	/* batched format: one dataset per field, holding a vector over counties */
+	inline void write_election_results_to_file(const std::vector<core::election::ElectionResultTemplate*> &results, const core::election::ElectionResultSerializerTemplate *serializer,
 		H5::H5File &file, const char* group_name="/election_results")
 	{
 		H5::Group group = file.createGroup(group_name);
 
-		for (size_t i = 0; i < results.size(); ++i) {
-			std::string this_election_group_name = std::string(group_name) + "/election_result_" + std::to_string(i);
-			write_election_result_to_file(results[i], serializer, file, this_election_group_name.c_str());
+		std::vector<std::pair<std::string, int>> list_of_fields = serializer->list_of_fields();
+		auto                                     columns        = write_election_results_to_columns(results, serializer);
+
+		for (size_t ifield = 0; ifield < list_of_fields.size(); ++ifield) {
+			std::visit([&](const auto &column) {
+				util::hdf5io::H5WriteVector(group, column, list_of_fields[ifield].first.c_str());
+			}, columns[ifield]);
+		}
+
+		group.close();
+	}
+
+	inline std::vector<core::election::ElectionResultSerializerTemplate::column_type> read_election_results_from_file(
+		const core::election::ElectionResultSerializerTemplate *serializer, H5::H5File &file, const char* group_name="/election_results")
+	{
+		H5::Group group = file.openGroup(group_name);
+
+		std::vector<std::pair<std::string, int>> list_of_fields = serializer->list_of_fields();
+		auto                                     columns        = serializer->make_columns(0);
+
+		for (size_t ifield = 0; ifield < list_of_fields.size(); ++ifield) {
+			std::visit([&](auto &column) {
+				util::hdf5io::H5ReadVector(group, column, list_of_fields[ifield].first.c_str());
+			}, columns[ifield]);
 		}
 
 		group.close();
+
+		return columns;
+	}
+
+	/* appends the results of all counties at each timestep to one extensible (time, county) dataset per field.
+	The history of a single county can be read back with read_agent_state_history_from_file */
+	class ElectionResultsTrajectoryWriter : private AgentStatesTrajectoryWriter<core::election::ElectionResultTemplate> {
+	private:
+		typedef AgentStatesTrajectoryWriter<core::election::ElectionResultTemplate> trajectory_writer_type;
+
+	public:
+		ElectionResultsTrajectoryWriter(const core::election::ElectionResultSerializerTemplate *serializer_, H5::H5File &file, size_t num_counties,
+			const char* group_name="/election_results_trajectory", const util::hdf5io::H5ChunkOptions &options={}) :
+			trajectory_writer_type(serializer_, file, num_counties, group_name, options) {}
+
+		using trajectory_writer_type::num_timesteps;
+		using trajectory_writer_type::append_columns;
+
+		inline size_t num_counties() const {
+			return num_nodes();
+		}
+
+		void append(const std::vector<core::election::ElectionResultTemplate*> &results) {
+			if (results.size() != num_counties()) {
+				throw std::invalid_argument("in \"ElectionResultsTrajectoryWriter::append\", number of counties doesn't match the trajectory");
+			}
+
+			/* the constructor only accepts election result serializers */
+			append_columns(write_election_results_to_columns(results, static_cast<const core::election::ElectionResultSerializerTemplate*>(serializer)));
+		}
+	};
+
+	inline std::vector<core::election::ElectionResultSerializerTemplate::column_type> read_election_results_timestep_from_file(
+		const core::election::ElectionResultSerializerTemplate *serializer, H5::H5File &file, size_t timestep, const char* group_name="/election_results_trajectory")
+	{
+		H5::Group group = file.openGroup(group_name);
+
+		std::vector<std::pair<std::string, int>> list_of_fields = serializer->list_of_fields();
+		auto                                     columns        = serializer->make_columns(0);
+
+		for (size_t ifield = 0; ifield < list_of_fields.size(); ++ifield) {
+			std::visit([&](auto &column) {
+				util::hdf5io::H5ReadRow(group, column, list_of_fields[ifield].first.c_str(), timestep);
+			}, columns[ifield]);
+		}
+
+		group.close();
+
+		return columns;
 	}
 }
\ No newline at end of file
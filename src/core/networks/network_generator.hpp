@@ -2,55 +2,154 @@
 
 #include <random>
 #include <algorithm>
+#include <numeric>
+#include <span>
+#include <cstdint>
 
 #include "../network.hpp"
 
 #include "../../util/util.hpp"
 #include "../../util/math.hpp"
+#include "../../util/map_util.hpp"
+#include "../../util/spatial_util.hpp"
 
 
 namespace BPsimulation::random {
 	template<class Agent>
-	void preferential_attachment(SocialNetwork<Agent> *network, int n_attachment) {
-		std::vector<size_t> degrees = network->degrees();
-		size_t total_degree = std::accumulate(degrees.begin(), degrees.end(), 0);
+	void preferential_attachment(SocialNetwork<Agent> *network, int n_attachment, bool parallel=false) {
+		const size_t num_nodes = network->num_nodes();
+		if (num_nodes < 2) {
+			return;
+		}
+
+		/* each node appears in endpoints as many times as its degree, so drawing a uniform element
+		of endpoints selects a node with a probability proportional to its degree */
+		std::vector<size_t>   endpoint_count = network->degrees();
+		std::vector<uint32_t> endpoints;
+		endpoints.reserve(std::accumulate(endpoint_count.begin(), endpoint_count.end(), (size_t)0) + 2*n_attachment*num_nodes + 2);
+		for (size_t node = 0; node < num_nodes; ++node) {
+			endpoints.insert(endpoints.end(), endpoint_count[node], (uint32_t)node);
+		}
 
 		auto nodes = network->nodes();
 		std::shuffle(nodes.begin(), nodes.end(), util::get_random_generator());
 
-		if (total_degree == 0) {
-			size_t i = nodes[network->num_nodes()-2];
-			size_t j = nodes[network->num_nodes()-1];
-
-			network->add_connection(i, j);
+		/* new connections are the pairs (endpoints[first_new_endpoint + 2*k], endpoints[first_new_endpoint + 2*k + 1]) */
+		const size_t first_new_endpoint = endpoints.size();
+		if (endpoints.empty()) {
+			size_t i = nodes[num_nodes-2];
+			size_t j = nodes[num_nodes-1];
 
-			degrees[i] += 1;
-			degrees[j] += 1;
-			total_degree = 2;
+			endpoints.push_back(i);
+			endpoints.push_back(j);
+			++endpoint_count[i];
+			++endpoint_count[j];
 		}
 
-		for (int i = 0; i < n_attachment; ++i) {
-			for (size_t node : nodes) {
-				size_t node_degree_save = degrees[node];
-				total_degree -= node_degree_save;
-				degrees[node] = 0;
-
-				std::uniform_int_distribution<size_t> distribution(0, total_degree-1);
-				size_t rdm = distribution(util::get_random_generator());
+		/* draws a node other than node among the first num_endpoints endpoints, or returns -1 if there are none */
+		auto draw_target = [&](size_t node, size_t num_endpoints) -> long long int {
+			if (endpoint_count[node] >= num_endpoints) {
+				return -1;
+			}
 
-				for (size_t j = 0;; ++j) {
-					if (rdm <= degrees[nodes[j]]) {
-						degrees[nodes[j]] += 1;
-						network->add_connection(node, nodes[j]);
+			std::uniform_int_distribution<size_t> distribution(0, num_endpoints-1);
+			size_t target;
+			do {
+				target = endpoints[distribution(util::get_random_generator())];
+			} while (target == node);
+
+			return target;
+		};
+
+		auto attach = [&](size_t node, long long int target) {
+			if (target >= 0) {
+				endpoints.push_back(node);
+				endpoints.push_back(target);
+				++endpoint_count[node];
+				++endpoint_count[target];
+			}
+		};
 
-						break;
+		std::vector<long long int> targets(parallel ? num_nodes : 0);
+		for (int i = 0; i < n_attachment; ++i) {
+			if (parallel) {
+				/* nodes are attached by batches drawing from the degrees at the start of the batch, a batch
+				being at most as large as the number of connections so that degrees do not drift too much */
+				for (size_t begin = 0, end; begin < num_nodes; begin = end) {
+					end = std::min(num_nodes, begin + std::max((size_t)1, endpoints.size()/2));
+
+					const size_t num_endpoints = endpoints.size();
+					#pragma omp parallel for
+					for (size_t idx = begin; idx < end; ++idx) {
+						targets[idx] = draw_target(nodes[idx], num_endpoints);
 					}
-					rdm -= degrees[nodes[j]];
+					for (size_t idx = begin; idx < end; ++idx) {
+						attach(nodes[idx], targets[idx]);
+					}
+				}
+			} else {
+				for (size_t node : nodes) {
+					attach(node, draw_target(node, endpoints.size()));
 				}
-				degrees[node]  = node_degree_save + 1;
-				total_degree  += node_degree_save + 2;
 			}
 		}
+
+		/* group both directions of the new connections by node */
+		std::vector<size_t> new_offsets(num_nodes+1, 0);
+		for (size_t k = first_new_endpoint; k < endpoints.size(); ++k) {
+			++new_offsets[endpoints[k]+1];
+		}
+		std::partial_sum(new_offsets.begin(), new_offsets.end(), new_offsets.begin());
+
+		std::vector<uint32_t> new_neighbors(new_offsets.back());
+		std::vector<size_t>   new_fill(new_offsets.begin(), new_offsets.end()-1);
+		for (size_t k = first_new_endpoint; k < endpoints.size(); k += 2) {
+			new_neighbors[new_fill[endpoints[k  ]]++] = endpoints[k+1];
+			new_neighbors[new_fill[endpoints[k+1]]++] = endpoints[k  ];
+		}
+
+		/* drop repeated connections, and the ones that already existed */
+		std::vector<size_t>   num_new(num_nodes);
+		std::vector<uint32_t> existing;
+		#pragma omp parallel for schedule(dynamic, 1024) private(existing)
+		for (size_t node = 0; node < num_nodes; ++node) {
+			auto begin = new_neighbors.begin() + new_offsets[node];
+			auto end   = new_neighbors.begin() + new_offsets[node+1];
+
+			std::sort(begin, end);
+			end = std::unique(begin, end);
+
+			std::span<const uint32_t> node_neighbors = network->neighbors(node);
+			if (!node_neighbors.empty()) {
+				existing.assign(node_neighbors.begin(), node_neighbors.end());
+				std::sort(existing.begin(), existing.end());
+
+				end = std::remove_if(begin, end, [&](uint32_t neighbor) {
+					return std::binary_search(existing.begin(), existing.end(), neighbor);
+				});
+			}
+
+			num_new[node] = std::distance(begin, end);
+		}
+
+		std::vector<size_t> offsets(num_nodes+1, 0);
+		for (size_t node = 0; node < num_nodes; ++node) {
+			offsets[node+1] = offsets[node] + network->degree(node) + num_new[node];
+		}
+
+		std::vector<uint32_t> neighbors(offsets.back());
+		std::vector<double>   weights(  offsets.back(), 1.d);
+		#pragma omp parallel for
+		for (size_t node = 0; node < num_nodes; ++node) {
+			std::span<const uint32_t> node_neighbors = network->neighbors(node);
+			std::span<const double>   node_weights   = network->neighbor_weights(node);
+
+			auto neighbors_end = std::copy(node_neighbors.begin(), node_neighbors.end(), neighbors.begin() + offsets[node]);
+			std::copy(node_weights.begin(), node_weights.end(), weights.begin() + offsets[node]);
+			std::copy(new_neighbors.begin() + new_offsets[node], new_neighbors.begin() + new_offsets[node] + num_new[node], neighbors_end);
+		}
+
+		network->assign_connections(std::move(offsets), std::move(neighbors), std::move(weights));
 	}
 
 	template<class Agent, class Type>
@@ -87,4 +186,65 @@ namespace BPsimulation::random {
 			}
 		}
 	}
+
+	/* same as above, but the closest nodes are found through a k-d tree over the coordinates
+	of the nodes, so the distance matrix is never computed */
+	template<class Agent, typename Type, size_t Dim>
+	void closest_neighbor_limited_attachment(SocialNetwork<Agent> *network, const std::vector<std::array<Type, Dim>> &coordinates,
+		const int n_attachment, const int n_attachment_max=0)
+	{
+		const int    n_attachment_max_ = std::max(n_attachment_max, n_attachment);
+		const size_t num_nodes         = network->num_nodes();
+
+		util::spatial::kd_tree<Type, Dim> tree(coordinates);
+
+		/* closest nodes by increasing distance, queried again for twice as many once a node went through them */
+		std::vector<size_t>              idxs(          num_nodes, 0);
+		std::vector<std::vector<size_t>> sorted_indexes(num_nodes);
+		#pragma omp parallel for
+		for (size_t node = 0; node < num_nodes; ++node) {
+			sorted_indexes[node] = tree.k_nearest(coordinates[node], 2*n_attachment_max_ + 1);
+		}
+
+		auto has_candidate = [&](size_t node) {
+			if (idxs[node] == sorted_indexes[node].size() && sorted_indexes[node].size() < num_nodes) {
+				sorted_indexes[node] = tree.k_nearest(coordinates[node], 2*sorted_indexes[node].size());
+			}
+			return idxs[node] < sorted_indexes[node].size();
+		};
+
+		auto nodes = network->nodes();
+		std::shuffle(nodes.begin(), nodes.end(), util::get_random_generator());
+
+		for (int i = 0; i < n_attachment; ++i) {
+			for (size_t node : nodes) {
+				if (network->neighbors(node).size() < n_attachment) {
+					while (has_candidate(node) && (
+						   node == sorted_indexes[node][idxs[node]]                       ||
+						   network->are_neighbors(node, sorted_indexes[node][idxs[node]]) ||
+						   network->neighbors(sorted_indexes[node][idxs[node]]).size() >= n_attachment_max_))
+					{
+						++idxs[node];
+					}
+
+					if (has_candidate(node)) {
+						network->add_connection(node, sorted_indexes[node][idxs[node]]);
+						++idxs[node];
+					}
+				}
+			}
+		}
+	}
+
+	template<class Agent, typename Type>
+	void closest_neighbor_limited_attachment(SocialNetwork<Agent> *network, const std::vector<Type> &lat, const std::vector<Type> &lon,
+		const int n_attachment, const int n_attachment_max=0)
+	{
+		std::vector<std::array<Type, 3>> coordinates(lat.size());
+		for (size_t node = 0; node < lat.size(); ++node) {
+			coordinates[node] = util::map::latLon_to_unit_vector(lat[node], lon[node]);
+		}
+
+		closest_neighbor_limited_attachment(network, coordinates, n_attachment, n_attachment_max);
+	}
 }
\ No newline at end of file
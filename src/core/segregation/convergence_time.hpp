@@ -1,41 +1,51 @@
 #pragma once
 
 #include "../../util/math.hpp"
+#include "../../util/matrix.hpp"
+#include "../../util/simd_util.hpp"
 
 #include "multiscalar.hpp"
 #include "multiscalar_util.hpp"
 
 
 namespace segregation::convergence_time {
-	template<typename Type>
-	std::vector<std::vector<double>> get_KLdiv_trajectories_versus_trajectory_end(const std::vector<std::vector<std::vector<Type>>> &trajectories) {
-		std::vector<std::vector<double>> KLdiv_trajectories(trajectories[0].size(), std::vector<double>(trajectories[0][0].size()));
+	template<class Trajectories>
+	::util::matrix::Matrix<double> get_KLdiv_trajectories_versus_trajectory_end(const Trajectories &trajectories, bool fast_log2=false) {
+		typedef std::remove_cvref_t<decltype(trajectories[0][0][0])> Storage;
 
-		std::vector<Type> placeholder(trajectories.size()), distribution(trajectories.size());
+		::util::matrix::Matrix<double> KLdiv_trajectories(::util::matrix::get_row_sizes(trajectories[0]));
 
-		#pragma omp parallel for private(placeholder, distribution)
-		for (size_t i = 0; i < trajectories[0].size(); ++i) {
-			placeholder.resize( trajectories.size());
+		std::vector<const Storage*> columns(trajectories.size());
+		std::vector<double>         distribution(trajectories.size());
+
+		#pragma omp parallel for schedule(dynamic) private(columns, distribution)
+		for (size_t i = 0; i < KLdiv_trajectories.size(); ++i) {
+			columns.resize(     trajectories.size());
 			distribution.resize(trajectories.size());
 
 			for (size_t k = 0; k < trajectories.size(); ++k) {
+				columns[k]      = trajectories[k][i].data();
 				distribution[k] = trajectories[k][i].back();
 			}
+			const std::vector<double> log2_distribution = ::util::simd::get_log2_reference(distribution);
 
-			for (size_t j = 0; j < trajectories[0][0].size(); ++j) {
-				for (size_t k = 0; k < trajectories.size(); ++k) {
-					placeholder[k] = trajectories[k][i][j];
-				}
-				KLdiv_trajectories[i][j] = ::util::math::get_KLdiv(placeholder, distribution);
+			if (fast_log2) {
+				::util::simd::get_KLdivs<true>( std::span<const Storage* const>(columns), log2_distribution, KLdiv_trajectories[i]);
+			} else {
+				::util::simd::get_KLdivs<false>(std::span<const Storage* const>(columns), log2_distribution, KLdiv_trajectories[i]);
 			}
 		}
 		
 		return KLdiv_trajectories;
 	}
 
+	using multiscalar::get_KLdiv_envelopes;
 	using multiscalar::get_focal_distance_indexes;
 	using multiscalar::get_focal_distances;
+	using multiscalar::get_focal_distance_indexes_from_envelopes;
+	using multiscalar::get_focal_distances_from_envelopes;
 
 	using multiscalar::get_distortion_coefs;
 	using multiscalar::get_distortion_coefs_from_KLdiv;
+	using multiscalar::get_distortion_coefs_from_envelopes;
 }
\ No newline at end of file
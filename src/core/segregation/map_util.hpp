@@ -1,47 +1,126 @@
 #pragma once
 
+#include <vector>
+#include <span>
+#include <cmath>
+#include <algorithm>
+#include <numeric>
+
 #include "../../util/map_util.hpp"
+#include "../../util/matrix.hpp"
 #include "../../util/math.hpp"
 #include "../../util/util.hpp"
 
 
 namespace segregation::map::util {
+	/* coordinates in radians and cosine of the latitudes, computed once for all the distances to a point */
 	template<typename Type>
-	std::vector<Type> get_distances_single(const std::vector<Type> &lat, const std::vector<Type> &lon, size_t idx) {
-		std::vector<Type> distances(lat.size());
+	class geodesic_coordinates {
+	public:
+		std::vector<Type> lat_rad, lon_rad, cos_lat;
+
+		geodesic_coordinates(const std::vector<Type> &lat, const std::vector<Type> &lon) :
+			lat_rad(lat.size()), lon_rad(lat.size()), cos_lat(lat.size())
+		{
+			#pragma omp parallel for simd
+			for (size_t i = 0; i < lat.size(); ++i) {
+				lat_rad[i] = ::util::math::deg_to_rad(lat[i]);
+				lon_rad[i] = ::util::math::deg_to_rad(lon[i]);
+				cos_lat[i] = std::cos(lat_rad[i]);
+			}
+		}
+
+		inline size_t size() const {
+			return lat_rad.size();
+		}
+	};
+
+	/* haversine distances (in meters, at least 1) from point idx to the first distances.size() points */
+	template<typename Type>
+	void get_distances_row(const geodesic_coordinates<Type> &coordinates, size_t idx, std::span<Type> distances) {
+		static const Type R = 6371000; // Radius of the earth in m
+
+		const Type  lat_i   = coordinates.lat_rad[idx];
+		const Type  lon_i   = coordinates.lon_rad[idx];
+		const Type  cos_i   = coordinates.cos_lat[idx];
+		const Type *lat_rad = coordinates.lat_rad.data();
+		const Type *lon_rad = coordinates.lon_rad.data();
+		const Type *cos_lat = coordinates.cos_lat.data();
+
+		#pragma omp simd
+		for (size_t j = 0; j < distances.size(); ++j) {
+			Type sin_dlat = std::sin((lat_rad[j] - lat_i)/2);
+			Type sin_dlon = std::sin((lon_rad[j] - lon_i)/2);
+			Type a        = sin_dlat*sin_dlat + cos_i*cos_lat[j]*sin_dlon*sin_dlon;
+
+			distances[j] = std::max((Type)1, 2*R*std::asin(std::min((Type)1, std::sqrt(a))));
+		}
+	}
+
+	/* calls func(i, row) with the distances row of every point indexes[i] without storing the whole matrix.
+	Rows are computed in parallel, each thread reusing its own buffer, so func must be thread-safe */
+	template<typename Type, class Func>
+	void for_each_distances_row(const geodesic_coordinates<Type> &coordinates, const std::vector<size_t> &indexes, const Func &func) {
+		std::vector<Type> row;
 
-		for (size_t j = 0; j < lat.size(); ++j) {
-			distances[j] = std::max((Type)1,
-				::util::map::latLon_to_meter_distance(lat[idx], lon[idx], lat[j], lon[j]));
+		#pragma omp parallel for schedule(dynamic) private(row)
+		for (size_t i = 0; i < indexes.size(); ++i) {
+			row.resize(coordinates.size());
+			get_distances_row(coordinates, indexes[i], std::span<Type>(row));
+
+			func(i, std::span<const Type>(row));
 		}
+	}
+	template<typename Type, class Func>
+	void for_each_distances_row(const std::vector<Type> &lat, const std::vector<Type> &lon, const Func &func) {
+		std::vector<size_t> indexes(lat.size());
+		std::iota(indexes.begin(), indexes.end(), 0);
+
+		for_each_distances_row(geodesic_coordinates<Type>(lat, lon), indexes, func);
+	}
+
+	template<typename Type>
+	std::vector<Type> get_distances_single(const std::vector<Type> &lat, const std::vector<Type> &lon, size_t idx) {
+		std::vector<Type> distances(lat.size());
+		get_distances_row(geodesic_coordinates<Type>(lat, lon), idx, std::span<Type>(distances));
 
 		return distances;
 	}
 
 	template<typename Type>
-	std::vector<std::vector<Type>> get_distances(const std::vector<Type> &lat, const std::vector<Type> &lon, const std::vector<size_t> &indexes) {
-		std::vector<std::vector<Type>> distances(indexes.size(),  std::vector<Type>(lat.size()));
+	::util::matrix::Matrix<Type> get_distances(const std::vector<Type> &lat, const std::vector<Type> &lon, const std::vector<size_t> &indexes) {
+		::util::matrix::Matrix<Type> distances(indexes.size(), lat.size());
+
+		geodesic_coordinates<Type> coordinates(lat, lon);
 
+		#pragma omp parallel for schedule(dynamic)
 		for (size_t i = 0; i < indexes.size(); ++i) {
-			distances[i] = get_distances_single(lat, lon, indexes[i]);
+			get_distances_row(coordinates, indexes[i], distances[i]);
 		}
 
 		return distances;
 	}
 
 	template<typename Type>
-	std::vector<std::vector<Type>> get_distances(const std::vector<Type> &lat, const std::vector<Type> &lon) {
-		std::vector<std::vector<Type>> distances(lat.size(),  std::vector<Type>(lat.size()));
+	::util::matrix::Matrix<Type> get_distances(const std::vector<Type> &lat, const std::vector<Type> &lon) {
+		::util::matrix::Matrix<Type> distances(lat.size(), lat.size());
 
+		geodesic_coordinates<Type> coordinates(lat, lon);
+
+		/* the haversine formula is exactly symmetric, so only the lower triangle is computed and then mirrored */
+		#pragma omp parallel for schedule(dynamic)
 		for (size_t i = 0; i < lat.size(); ++i) {
-			for (size_t j = 0; j < i; ++j) {
-				distances[i][j] = std::max((Type)1,
-					::util::map::latLon_to_meter_distance(lat[i], lon[i], lat[j], lon[j]));
-				distances[j][i] = distances[i][j];
-			}
+			get_distances_row(coordinates, i, distances[i].first(i));
 			distances[i][i] = 0;
 		}
 
+		#pragma omp parallel for schedule(dynamic)
+		for (size_t i = 0; i < lat.size(); ++i) {
+			for (size_t j = i+1; j < lat.size(); ++j) {
+				distances[i][j] = distances[j][i];
+			}
+		}
+
 		return distances;
 	}
-}
\ No newline at end of file
+}
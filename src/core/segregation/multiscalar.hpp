@@ -2,49 +2,165 @@
 
 #include "../../util/math.hpp"
 #include "../../util/util.hpp"
+#include "../../util/map_util.hpp"
+#include "../../util/spatial_util.hpp"
+#include "../../util/matrix.hpp"
+#include "../../util/simd_util.hpp"
 
 #include "multiscalar_util.hpp"
+#include "map_util.hpp"
 
 #include <functional>
+#include <span>
+#include <type_traits>
+#include <stdexcept>
 
 
 namespace segregation::multiscalar {
-	template<typename Type>
-	std::vector<std::vector<size_t>> get_closest_neighbors(const std::vector<std::vector<Type>> &distances) {
-		std::vector<std::vector<size_t>> indexes(distances.size());
+	/* every matrix argument can be any matrix indexable as m[i][j] (nested std::vector, util::matrix::Matrix or MatrixView),
+	results are returned as contiguous util::matrix::Matrix (one allocation, rows as std::span) and trajectories as a
+	util::matrix::Tensor3 (trajectories[k] being the N x N matrix of category k) */
+	template<class Distances>
+	::util::matrix::Matrix<size_t> get_closest_neighbors(const Distances &distances) {
+		::util::matrix::Matrix<size_t> indexes(::util::matrix::get_row_sizes(distances));
 
 		#pragma omp parallel for
 		for (size_t i = 0; i < distances.size(); ++i) {
-			indexes[i] = ::util::math::get_sorted_indexes(distances[i]);
+			const auto &Y = distances[i];
+
+			std::iota(indexes[i].begin(), indexes[i].end(), 0);
+			std::sort(indexes[i].begin(), indexes[i].end(), [&Y](size_t i, size_t j) {
+				return Y[i] < Y[j];
+			});
 		}
 
 		return indexes;
 	}
 
+	/* truncated mode: only the k closest neighbors of each unit are kept (by increasing distance),
+	trajectories, KL-divergence trajectories and distortion coefficients then only cover these k neighbors,
+	so the KL-divergence has to be computed against the total distribution (util::get_total_distribution) */
+	template<class Distances>
+	::util::matrix::Matrix<size_t> get_closest_neighbors(const Distances &distances, size_t k) {
+		std::vector<size_t> row_sizes = ::util::matrix::get_row_sizes(distances);
+		for (size_t &row_size : row_sizes) {
+			row_size = std::min(k, row_size);
+		}
+		::util::matrix::Matrix<size_t> indexes(row_sizes);
+
+		std::vector<size_t> order;
+
+		#pragma omp parallel for private(order)
+		for (size_t i = 0; i < distances.size(); ++i) {
+			const auto &Y = distances[i];
+
+			order.resize(Y.size());
+			std::iota(order.begin(), order.end(), 0);
+
+			std::partial_sort(order.begin(), order.begin() + row_sizes[i], order.end(), [&Y](size_t i, size_t j) {
+				return Y[i] < Y[j];
+			});
+			std::copy(order.begin(), order.begin() + row_sizes[i], indexes[i].begin());
+		}
+
+		return indexes;
+	}
+
+	/* same without any distance matrix, through a k-d tree over the positions of the units */
 	template<typename Type>
-	std::vector<std::vector<Type>> get_trajectories_single(const std::vector<Type> &vect, const std::vector<std::vector<size_t>> &indexes) {
-		std::vector<std::vector<Type>> trajectory(indexes.size(), std::vector<Type>(indexes.size()));
+	::util::matrix::Matrix<size_t> get_closest_neighbors(const std::vector<Type> &lat, const std::vector<Type> &lon, size_t k) {
+		std::vector<std::array<Type, 3>> coordinates(lat.size());
+		for (size_t i = 0; i < lat.size(); ++i) {
+			coordinates[i] = ::util::map::latLon_to_unit_vector(lat[i], lon[i]);
+		}
+
+		::util::spatial::kd_tree<Type, 3> tree(coordinates);
+
+		::util::matrix::Matrix<size_t> indexes(lat.size(), std::min(k, lat.size()));
+
+		#pragma omp parallel for schedule(dynamic)
+		for (size_t i = 0; i < lat.size(); ++i) {
+			std::vector<size_t> nearest = tree.k_nearest(coordinates[i], k);
+			std::copy(nearest.begin(), nearest.end(), indexes[i].begin());
+		}
+
+		return indexes;
+	}
+
+	/* truncated mode stopping at convergence: the number of neighbors of each unit starts at k_min and is doubled
+	until the KL-divergence of its k closest neighbors (against the total distribution) is below convergence_threshold,
+	so rows have different sizes */
+	template<typename Type1, typename Type2>
+	::util::matrix::Matrix<size_t> get_closest_neighbors(const std::vector<std::vector<Type1>> &vects, const std::vector<Type2> &lat, const std::vector<Type2> &lon,
+		double convergence_threshold, size_t k_min=16)
+	{
+		std::vector<std::array<Type2, 3>> coordinates(lat.size());
+		for (size_t i = 0; i < lat.size(); ++i) {
+			coordinates[i] = ::util::map::latLon_to_unit_vector(lat[i], lon[i]);
+		}
+
+		::util::spatial::kd_tree<Type2, 3> tree(coordinates);
+
+		std::vector<Type1> total_distribution = util::get_total_distribution(vects);
+
+		std::vector<std::vector<size_t>> indexes(lat.size());
+		std::vector<Type1> accumulated(vects.size());
+
+		#pragma omp parallel for schedule(dynamic) private(accumulated)
+		for (size_t i = 0; i < lat.size(); ++i) {
+			for (size_t num_neighbors = std::max((size_t)1, k_min);; num_neighbors *= 2) {
+				indexes[i] = tree.k_nearest(coordinates[i], num_neighbors);
+				if (indexes[i].size() == lat.size()) {
+					break;
+				}
+
+				accumulated.assign(vects.size(), 0);
+				Type1 total = 0;
+				for (size_t k = 0; k < vects.size(); ++k) {
+					for (size_t idx : indexes[i]) {
+						accumulated[k] += vects[k][idx];
+					}
+					total += accumulated[k];
+				}
+				for (size_t k = 0; k < vects.size(); ++k) {
+					accumulated[k] /= total;
+				}
+
+				if (::util::math::get_KLdiv(accumulated, total_distribution) < convergence_threshold) {
+					break;
+				}
+			}
+		}
+
+		return ::util::matrix::Matrix<size_t>::from_rows(indexes);
+	}
+
+	template<typename Type, class Indexes>
+	::util::matrix::Matrix<Type> get_trajectories_single(const std::vector<Type> &vect, const Indexes &indexes) {
+		::util::matrix::Matrix<Type> trajectory(::util::matrix::get_row_sizes(indexes));
 
 		#pragma omp parallel for
 		for (size_t i = 0; i < indexes.size(); ++i) {
-			Type total = 0.d;
 			for (size_t j = 0; j < indexes[i].size(); ++j) {
-				trajectory[i][j] = trajectory[i][j] + vect[indexes[i][j]];
+				trajectory[i][j] = vect[indexes[i][j]];
 			}
 		}
 
 		return trajectory;
 	}
 
-	template<typename Type>
-	std::vector<std::vector<std::vector<Type>>> get_trajectories(const std::vector<std::vector<Type>> &vects, const std::vector<std::vector<size_t>> &indexes) {
-		std::vector<std::vector<std::vector<Type>>> trajectories(vects.size(),
-			std::vector<std::vector<Type>>(indexes.size(), std::vector<Type>(indexes[0].size())));
+	/* Storage is the type the trajectories are stored as (for example float, to halve the memory footprint),
+	the running sums being computed as Type */
+	template<typename Storage=void, typename Type, class Indexes>
+	::util::matrix::Tensor3<std::conditional_t<std::is_void_v<Storage>, Type, Storage>> get_trajectories(const std::vector<std::vector<Type>> &vects, const Indexes &indexes) {
+		::util::matrix::Tensor3<std::conditional_t<std::is_void_v<Storage>, Type, Storage>> trajectories(vects.size(), ::util::matrix::get_row_sizes(indexes));
 
-		#pragma omp parallel for
+		std::vector<Type> running_sum(vects.size());
+
+		#pragma omp parallel for private(running_sum)
 		for (size_t i = 0; i < indexes.size(); ++i) {
 			Type total = 0.d;
-			std::vector<Type> running_sum(vects.size(), 0);
+			running_sum.assign(vects.size(), 0);
 
 			for (size_t j = 0; j < indexes[i].size(); ++j) {
 				for (size_t k = 0; k < vects.size(); ++k) {
@@ -60,91 +176,192 @@ namespace segregation::multiscalar {
 		return trajectories;
 	}
 
-	template<typename Type>
-	std::vector<std::vector<double>> get_KLdiv_trajectories(const std::vector<std::vector<std::vector<Type>>> &trajectories, const std::vector<Type> &ref_distribution={}) {
-		std::vector<std::vector<double>> KLdiv_trajectories(trajectories[0].size(), std::vector<double>(trajectories[0][0].size()));
+	/* true if any row doesn't span all units, as for truncated (k-nearest) trajectories */
+	template<class Rows>
+	bool has_truncated_rows(const Rows &rows) {
+		for (size_t i = 0; i < rows.size(); ++i) {
+			if (rows[i].size() < rows.size()) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/* the KL-divergences of each row are computed in one batch by util::simd::get_KLdivs,
+	with a polynomial log2 approximation (absolute error below 5e-11) if fast_log2 is true.
+	The default reference distribution is the end of the first row, so it has to be passed for truncated trajectories */
+	template<class Trajectories, typename Type=double>
+	::util::matrix::Matrix<double> get_KLdiv_trajectories(const Trajectories &trajectories, const std::vector<Type> &ref_distribution={}, bool fast_log2=false) {
+		typedef std::remove_cvref_t<decltype(trajectories[0][0][0])> Storage;
+
+		::util::matrix::Matrix<double> KLdiv_trajectories(::util::matrix::get_row_sizes(trajectories[0]));
 
 		std::vector<Type> total_distribution(trajectories.size());
 		if (ref_distribution.empty()) {
+			if (has_truncated_rows(trajectories[0])) {
+				throw std::invalid_argument("in \"get_KLdiv_trajectories\", truncated trajectories require the total distribution as ref_distribution");
+			}
 			for (size_t k = 0; k < trajectories.size(); ++k) {
 				total_distribution[k] = trajectories[k][0].back();
 			}
 		} else {
 			total_distribution = ref_distribution;
 		}
+		const std::vector<double> log2_total_distribution = ::util::simd::get_log2_reference(total_distribution);
 
-		std::vector<Type> placeholder(trajectories.size());
+		std::vector<const Storage*> columns(trajectories.size());
 
-		#pragma omp parallel for private(placeholder)
-		for (size_t i = 0; i < trajectories[0].size(); ++i) {
-			placeholder.resize(trajectories.size());
+		#pragma omp parallel for schedule(dynamic) private(columns)
+		for (size_t i = 0; i < KLdiv_trajectories.size(); ++i) {
+			columns.resize(trajectories.size());
+			for (size_t k = 0; k < trajectories.size(); ++k) {
+				columns[k] = trajectories[k][i].data();
+			}
 
-			for (size_t j = 0; j < trajectories[0][0].size(); ++j) {
-				for (size_t k = 0; k < trajectories.size(); ++k) {
-					placeholder[k] = trajectories[k][i][j];
-				}
-				KLdiv_trajectories[i][j] = ::util::math::get_KLdiv(placeholder, total_distribution);
+			if (fast_log2) {
+				::util::simd::get_KLdivs<true>( std::span<const Storage* const>(columns), log2_total_distribution, KLdiv_trajectories[i]);
+			} else {
+				::util::simd::get_KLdivs<false>(std::span<const Storage* const>(columns), log2_total_distribution, KLdiv_trajectories[i]);
 			}
 		}
 		
 		return KLdiv_trajectories;
 	}
 
-	template<typename Type>
-	std::vector<std::vector<double>> get_KLdiv_trajectories_single(const std::vector<std::vector<Type>> &trajectory) {
-		std::vector<std::vector<double>> KLdiv_trajectories(trajectory.size(), std::vector<double>(trajectory.size()));
+	template<class Trajectory>
+	::util::matrix::Matrix<double> get_KLdiv_trajectories_single(const Trajectory &trajectory) {
+		if (has_truncated_rows(trajectory)) {
+			throw std::invalid_argument("in \"get_KLdiv_trajectories_single\", the end of truncated trajectories isn't the total distribution");
+		}
+
+		::util::matrix::Matrix<double> KLdiv_trajectories(::util::matrix::get_row_sizes(trajectory));
 
 		double total_distribution = trajectory[0].back();
 
 		#pragma omp parallel for
 		for (size_t i = 0; i < trajectory.size(); ++i) {
 			for (size_t j = 0; j < trajectory[i].size(); ++j) {
-				KLdiv_trajectories[i][j] = ::util::math::get_KLdiv_single(trajectory[i][j], total_distribution);
+				KLdiv_trajectories[i][j] = ::util::math::get_KLdiv_single((double)trajectory[i][j], total_distribution);
 			}
 		}
 		
 		return KLdiv_trajectories;
 	}
 
-	std::vector<std::vector<size_t>> get_focal_distance_indexes(const std::vector<std::vector<double>> &KLdiv_trajectories, const std::vector<double> &convergence_thresholds) {
-		std::vector<std::vector<size_t>> focal_distance_indexes(KLdiv_trajectories.size(), std::vector<size_t>(convergence_thresholds.size()));
+	/* max envelope of a KL-divergence trajectory, as integrated by the distortion coefficients:
+	envelope[j] = max(0, KLdiv[j], ..., KLdiv[n-2]) for j < n-1 (so non-increasing) and envelope[n-1] = KLdiv[n-1].
+	It is computed once and shared by the focal distances and the distortion coefficients */
+	template<class Row>
+	void get_KLdiv_envelope(const Row &KLdiv_trajectory, std::span<double> envelope) {
+		const size_t n = KLdiv_trajectory.size();
+		if (n == 0) {
+			return;
+		}
+
+		double max_KL_div = 0;
+		envelope[n-1] = KLdiv_trajectory[n-1];
+		for (long long int j = n-2; j >= 0; --j) {
+			max_KL_div  = std::max(max_KL_div, (double)KLdiv_trajectory[j]);
+			envelope[j] = max_KL_div;
+		}
+	}
+
+	template<class KLdivMatrix>
+	::util::matrix::Matrix<double> get_KLdiv_envelopes(const KLdivMatrix &KLdiv_trajectories) {
+		::util::matrix::Matrix<double> envelopes(::util::matrix::get_row_sizes(KLdiv_trajectories));
 
 		#pragma omp parallel for
 		for (size_t i = 0; i < KLdiv_trajectories.size(); ++i) {
-			size_t idx = KLdiv_trajectories[0].size()-1;
-			for (size_t j = 0; j < convergence_thresholds.size(); ++j) {
-				while (idx > 0 && KLdiv_trajectories[i][idx] < convergence_thresholds[j]) {
-					--idx;
-				}
+			get_KLdiv_envelope(KLdiv_trajectories[i], envelopes[i]);
+		}
 
-				focal_distance_indexes[i][j] = idx;
+		return envelopes;
+	}
+
+	/* last index of a trajectory with a KL-divergence of at least convergence_threshold (0 if there is none),
+	by binary search in its envelope */
+	inline size_t get_focal_distance_index(std::span<const double> envelope, double convergence_threshold) {
+		const size_t n = envelope.size();
+		if (n <= 1 || envelope[n-1] >= convergence_threshold) {
+			return n == 0 ? 0 : n-1;
+		}
+
+		const size_t num_above = std::partition_point(envelope.begin(), envelope.begin() + (n-1), [convergence_threshold](double max_KL_div) {
+			return max_KL_div >= convergence_threshold;
+		}) - envelope.begin();
+
+		return num_above == 0 ? 0 : num_above-1;
+	}
+
+	template<class EnvelopeMatrix>
+	::util::matrix::Matrix<size_t> get_focal_distance_indexes_from_envelopes(const EnvelopeMatrix &envelopes, const std::vector<double> &convergence_thresholds) {
+		::util::matrix::Matrix<size_t> focal_distance_indexes(envelopes.size(), convergence_thresholds.size());
+
+		#pragma omp parallel for
+		for (size_t i = 0; i < envelopes.size(); ++i) {
+			for (size_t j = 0; j < convergence_thresholds.size(); ++j) {
+				focal_distance_indexes[i][j] = get_focal_distance_index(std::span<const double>(envelopes[i]), convergence_thresholds[j]);
 			}
 		}
 		
 		return focal_distance_indexes;
 	}
 
-	template<typename Type>
-	std::vector<std::vector<Type>> get_focal_distances(const std::vector<std::vector<double>> &KLdiv_trajectories, const std::vector<double> &convergence_thresholds, const std::vector<std::vector<Type>> &Xvalues) {
-		std::vector<std::vector<Type>> focal_distances(KLdiv_trajectories.size(), std::vector<Type>(convergence_thresholds.size()));
+	template<class EnvelopeMatrix, class XMatrix>
+	::util::matrix::Matrix<::util::matrix::element_type<XMatrix>> get_focal_distances_from_envelopes(const EnvelopeMatrix &envelopes, const std::vector<double> &convergence_thresholds, const XMatrix &Xvalues) {
+		::util::matrix::Matrix<::util::matrix::element_type<XMatrix>> focal_distances(envelopes.size(), convergence_thresholds.size());
 
 		#pragma omp parallel for
+		for (size_t i = 0; i < envelopes.size(); ++i) {
+			for (size_t j = 0; j < convergence_thresholds.size(); ++j) {
+				focal_distances[i][j] = Xvalues[i][get_focal_distance_index(std::span<const double>(envelopes[i]), convergence_thresholds[j])];
+			}
+		}
+		
+		return focal_distances;
+	}
+
+	/* the focal distance of each threshold is the last point of the trajectory above it, independently of the order of the thresholds */
+	template<class KLdivMatrix>
+	::util::matrix::Matrix<size_t> get_focal_distance_indexes(const KLdivMatrix &KLdiv_trajectories, const std::vector<double> &convergence_thresholds) {
+		::util::matrix::Matrix<size_t> focal_distance_indexes(KLdiv_trajectories.size(), convergence_thresholds.size());
+
+		std::vector<double> envelope;
+
+		#pragma omp parallel for private(envelope)
 		for (size_t i = 0; i < KLdiv_trajectories.size(); ++i) {
-			size_t idx = KLdiv_trajectories[0].size()-1;
+			envelope.resize(KLdiv_trajectories[i].size());
+			get_KLdiv_envelope(KLdiv_trajectories[i], std::span<double>(envelope));
+
 			for (size_t j = 0; j < convergence_thresholds.size(); ++j) {
-				while (idx > 0 && KLdiv_trajectories[i][idx] < convergence_thresholds[j]) {
-					--idx;
-				}
+				focal_distance_indexes[i][j] = get_focal_distance_index(std::span<const double>(envelope), convergence_thresholds[j]);
+			}
+		}
+		
+		return focal_distance_indexes;
+	}
+
+	template<class KLdivMatrix, class XMatrix>
+	::util::matrix::Matrix<::util::matrix::element_type<XMatrix>> get_focal_distances(const KLdivMatrix &KLdiv_trajectories, const std::vector<double> &convergence_thresholds, const XMatrix &Xvalues) {
+		::util::matrix::Matrix<::util::matrix::element_type<XMatrix>> focal_distances(KLdiv_trajectories.size(), convergence_thresholds.size());
 
-				focal_distances[i][j] = Xvalues[i][idx];
+		std::vector<double> envelope;
+
+		#pragma omp parallel for private(envelope)
+		for (size_t i = 0; i < KLdiv_trajectories.size(); ++i) {
+			envelope.resize(KLdiv_trajectories[i].size());
+			get_KLdiv_envelope(KLdiv_trajectories[i], std::span<double>(envelope));
+
+			for (size_t j = 0; j < convergence_thresholds.size(); ++j) {
+				focal_distances[i][j] = Xvalues[i][get_focal_distance_index(std::span<const double>(envelope), convergence_thresholds[j])];
 			}
 		}
 		
 		return focal_distances;
 	}
 
-	template<typename Type1, typename Type2=double>
-	std::vector<Type2> get_distortion_coefs(const std::vector<std::vector<Type1>> &focal_distances, const std::vector<double> &convergence_thresholds, const Type2 &normalization_coef=1.d) {
+	template<class FocalMatrix, typename Type2=double>
+	std::vector<Type2> get_distortion_coefs(const FocalMatrix &focal_distances, const std::vector<double> &convergence_thresholds, const Type2 &normalization_coef=1.d) {
 		std::vector<Type2> distortion_coefs = ::util::math::integrals(focal_distances, convergence_thresholds);
 
 		for (Type2 &distortion_coef : distortion_coefs) {
@@ -154,33 +371,134 @@ namespace segregation::multiscalar {
 		return distortion_coefs;
 	}
 
-	template<typename Type1=double, typename Type2=double>
-	std::vector<Type1> get_distortion_coefs_from_KLdiv(const std::vector<std::vector<double>> &KLdiv_trajectories, const std::vector<std::vector<Type1>> &Xvalues={}, const Type2 &normalization_coef=1.d) {
-		std::vector<Type1> distortion_coefs(KLdiv_trajectories.size(), 0);
+	/* trapezoidal integral of the envelope of a trajectory, along Xvalues if not empty (one per point) */
+	template<typename Type1>
+	double get_distortion_coef_from_envelope(std::span<const double> envelope, std::span<const Type1> Xvalues) {
+		const size_t n = envelope.size();
+
+		double distortion_coef = 0;
+		for (long long int j = n-2; j >= 0; --j) {
+			double delta_X = 1;
+			if (!Xvalues.empty()) {
+				delta_X = Xvalues[j+1] - Xvalues[j];
+			}
+			distortion_coef += delta_X*(envelope[j+1] + envelope[j])/2;
+		}
+		if (!Xvalues.empty() && n > 1) {
+			distortion_coef += Xvalues[0]*envelope[0];
+		}
+
+		return distortion_coef;
+	}
+
+	template<class EnvelopeMatrix, class XMatrix=std::vector<std::vector<double>>, typename Type2=double>
+	std::vector<::util::matrix::element_type<XMatrix>> get_distortion_coefs_from_envelopes(const EnvelopeMatrix &envelopes, const XMatrix &Xvalues={}, const Type2 &normalization_coef=1.d) {
+		typedef ::util::matrix::element_type<XMatrix> Type1;
+
+		std::vector<Type1> distortion_coefs(envelopes.size(), 0);
 
 		#pragma omp parallel for
+		for (size_t i = 0; i < envelopes.size(); ++i) {
+			std::span<const Type1> Xvalues_i;
+			if (!Xvalues.empty()) {
+				Xvalues_i = std::span<const Type1>(Xvalues[i]);
+			}
+
+			distortion_coefs[i] = get_distortion_coef_from_envelope(std::span<const double>(envelopes[i]), Xvalues_i)/normalization_coef;
+		}
+
+		return distortion_coefs;
+	}
+
+	template<class KLdivMatrix, class XMatrix=std::vector<std::vector<double>>, typename Type2=double>
+	std::vector<::util::matrix::element_type<XMatrix>> get_distortion_coefs_from_KLdiv(const KLdivMatrix &KLdiv_trajectories, const XMatrix &Xvalues={}, const Type2 &normalization_coef=1.d) {
+		typedef ::util::matrix::element_type<XMatrix> Type1;
+
+		std::vector<Type1> distortion_coefs(KLdiv_trajectories.size(), 0);
+
+		std::vector<double> envelope;
+
+		#pragma omp parallel for private(envelope)
 		for (size_t i = 0; i < KLdiv_trajectories.size(); ++i) {
-			double max_KL_div = 0, old_max_KL_div = KLdiv_trajectories[i].back();
+			envelope.resize(KLdiv_trajectories[i].size());
+			get_KLdiv_envelope(KLdiv_trajectories[i], std::span<double>(envelope));
+
+			std::span<const Type1> Xvalues_i;
+			if (!Xvalues.empty()) {
+				Xvalues_i = std::span<const Type1>(Xvalues[i]);
+			}
 
-			for (long long int j = KLdiv_trajectories[0].size()-2; j >= 0; --j) {
-				max_KL_div = std::max(max_KL_div, KLdiv_trajectories[i][j]);
+			distortion_coefs[i] = get_distortion_coef_from_envelope(std::span<const double>(envelope), Xvalues_i)/normalization_coef;
+		}
 
-				Type1 delta_X = 1;
-				if (!Xvalues.empty()) {
-					delta_X = Xvalues[i][j+1] - Xvalues[i][j];
-				}
-				distortion_coefs[i] += delta_X*(old_max_KL_div + max_KL_div)/2;
+		return distortion_coefs;
+	}
+
+	/* distortion coefficient of a single unit: the running sums are accumulated forward along its sorted neighbors
+	(as in get_trajectories, so units with a null population don't leave any rounding residue), storing the KL-divergence
+	of each prefix, which are then walked backward to integrate their max envelope.
+	running_sum and KLdivs are reusable buffers */
+	template<typename Type1, typename Type2>
+	double get_distortion_coef_single(const std::vector<std::vector<Type1>> &vects, const std::vector<double> &log2_total_distribution,
+		std::span<const size_t> indexes, std::span<const Type2> Xvalues, std::vector<double> &running_sum, std::vector<double> &KLdivs)
+	{
+		static const double epsilon = 1e-18;
+
+		if (indexes.empty()) {
+			return 0;
+		}
+
+		running_sum.assign(vects.size(), 0);
+		KLdivs.resize(indexes.size());
+		double total = 0;
+		for (size_t j = 0; j < indexes.size(); ++j) {
+			for (size_t k = 0; k < vects.size(); ++k) {
+				running_sum[k] += vects[k][indexes[j]];
+				total          += vects[k][indexes[j]];
+			}
 
-				old_max_KL_div = max_KL_div;
+			double KLdiv = 0;
+			for (size_t k = 0; k < vects.size(); ++k) {
+				double proportion = running_sum[k]/total;
+				if (proportion > epsilon) {
+					KLdiv += proportion*(std::log2(proportion) - log2_total_distribution[k]);
+				}
 			}
+			KLdivs[j] = KLdiv;
+		}
+
+		double distortion_coef = 0;
+		double max_KL_div = 0, old_max_KL_div = KLdivs.back();
+
+		for (long long int j = indexes.size()-2; j >= 0; --j) {
+			max_KL_div = std::max(max_KL_div, KLdivs[j]);
+
+			double delta_X = 1;
 			if (!Xvalues.empty()) {
-				distortion_coefs[i] += Xvalues[i][0]*max_KL_div;
+				delta_X = Xvalues[j+1] - Xvalues[j];
 			}
+			distortion_coef += delta_X*(old_max_KL_div + max_KL_div)/2;
 
-			distortion_coefs[i] /= normalization_coef;
+			old_max_KL_div = max_KL_div;
+		}
+		if (!Xvalues.empty()) {
+			distortion_coef += Xvalues[0]*max_KL_div;
 		}
 
-		return distortion_coefs;
+		return distortion_coef;
+	}
+
+	template<typename Type1>
+	std::vector<double> get_log2_total_distribution(const std::vector<std::vector<Type1>> &vects) {
+		static const double epsilon = 1e-18;
+
+		std::vector<Type1>  total_distribution = util::get_total_distribution(vects);
+		std::vector<double> log2_total_distribution(total_distribution.size());
+		for (size_t k = 0; k < total_distribution.size(); ++k) {
+			log2_total_distribution[k] = std::log2(std::max(epsilon, (double)total_distribution[k]));
+		}
+
+		return log2_total_distribution;
 	}
 
 	template<typename Type1, typename Type2=double, typename Type3=double>
@@ -189,77 +507,99 @@ namespace segregation::multiscalar {
 		const std::function<std::pair<std::vector<size_t>, std::vector<Type2>>(size_t)> func,
 		const Type3 normalization_coef=1.d)
 	{
-		std::vector<Type1> distortion_coefs(vects[0].size(), 0);
-
-		std::vector<Type1> traj(vects.size());
-		std::vector<Type1> total_distribution = util::get_total_distribution(vects);
-
-		std::vector<std::vector<size_t>> indexes_slice(1);
-		std::vector<std::vector<Type2>>  Xvalues_slice(1);
+		std::vector<Type1>  distortion_coefs(vects[0].size(), 0);
+		std::vector<double> log2_total_distribution = get_log2_total_distribution(vects);
 
+		std::vector<double> running_sum, KLdivs;
 
-		#pragma omp parallel for private(traj, indexes_slice, Xvalues_slice)
+		#pragma omp parallel for schedule(dynamic) private(running_sum, KLdivs)
 		for (size_t i = 0; i < vects[0].size(); ++i) {
-			traj.resize(vects.size());
-			indexes_slice.resize(1);
-			Xvalues_slice.resize(1);
-
 			auto [indexes, Xvalues] = func(i);
-			indexes_slice[0]        = indexes;
-			Xvalues_slice[0]        = Xvalues;
 
-			auto this_trajectories_ = segregation::multiscalar::get_trajectories(vects, indexes_slice);
+			distortion_coefs[i] = get_distortion_coef_single(vects, log2_total_distribution,
+				std::span<const size_t>(indexes), std::span<const Type2>(Xvalues), running_sum, KLdivs)/normalization_coef;
+		}
 
-			for (size_t k = 0; k < vects.size(); ++k) {
-				traj[k] = this_trajectories_[k][0].back();
-			}
-			double max_KL_div = 0, old_max_KL_div = ::util::math::get_KLdiv(traj, total_distribution);
+		return distortion_coefs;
+	}
 
-			for (long long int j = indexes.size()-2; j >= 0; --j) {
-				for (size_t k = 0; k < vects.size(); ++k) {
-					traj[k] = this_trajectories_[k][0][j];
-				}
-				double KL_div = ::util::math::get_KLdiv(traj, total_distribution);
-				max_KL_div   = std::max(max_KL_div, KL_div);
+	template<typename Type1, class Indexes, typename Type3=double, class XMatrix=std::vector<std::vector<double>>>
+		requires requires(const Indexes &indexes) { (size_t)indexes[0][0]; }
+	std::vector<Type1> get_distortion_coefs_fast(
+		const std::vector<std::vector<Type1>> &vects, const Indexes &indexes,
+		const Type3 normalization_coef=1.d,
+		const XMatrix &Xvalues={})
+	{
+		typedef ::util::matrix::element_type<XMatrix> Type2;
 
-				Type2 delta_X = 1;
-				if (!Xvalues.empty()) {
-					delta_X = Xvalues[j+1] - Xvalues[j];
-				}
-				distortion_coefs[i] += delta_X*(old_max_KL_div + max_KL_div)/2;
+		std::vector<Type1>  distortion_coefs(indexes.size(), 0);
+		std::vector<double> log2_total_distribution = get_log2_total_distribution(vects);
 
-				old_max_KL_div = max_KL_div;
-			}
+		std::vector<double> running_sum, KLdivs;
+
+		#pragma omp parallel for schedule(dynamic) private(running_sum, KLdivs)
+		for (size_t i = 0; i < indexes.size(); ++i) {
+			std::span<const Type2> Xvalues_i;
 			if (!Xvalues.empty()) {
-				distortion_coefs[i] += Xvalues[0]*max_KL_div;
+				Xvalues_i = std::span<const Type2>(Xvalues[i]);
 			}
-		}
 
-		for (Type1 &distortion_coef : distortion_coefs) {
-			distortion_coef /= normalization_coef;
+			distortion_coefs[i] = get_distortion_coef_single(vects, log2_total_distribution,
+				std::span<const size_t>(indexes[i]), Xvalues_i, running_sum, KLdivs)/normalization_coef;
 		}
-		
+
 		return distortion_coefs;
 	}
 
+	/* the neighbors of each unit are sorted on the fly from its coordinates, so no distance matrix is stored,
+	with the distances (in meters) as Xvalues if use_distances is true, and only the k closest ones if k > 0 */
 	template<typename Type1, typename Type2=double, typename Type3=double>
 	std::vector<Type1> get_distortion_coefs_fast(
-		const std::vector<std::vector<Type1>> &vects, const std::vector<std::vector<size_t>> &indexes,
-		const Type3 normalization_coef=1.d,
-		const std::vector<std::vector<Type2>> &Xvalues={})
+		const std::vector<std::vector<Type1>> &vects, const std::vector<Type2> &lat, const std::vector<Type2> &lon,
+		const Type3 normalization_coef=1.d, bool use_distances=false, size_t k=0)
 	{
-		return get_normalized_distortion_coefs_fast(vects,
-			(std::function<std::pair<std::vector<size_t>, std::vector<Type2>>(size_t)>) [&indexes, &Xvalues](size_t i) {
-				if (Xvalues.empty()) {
-					return std::pair<std::vector<size_t>, std::vector<Type2>>(indexes[i], {});
-				} else {
-					return std::pair<std::vector<size_t>, std::vector<Type2>>(indexes[i], Xvalues[i]);
+		std::vector<Type1>  distortion_coefs(lat.size(), 0);
+		std::vector<double> log2_total_distribution = get_log2_total_distribution(vects);
+
+		const size_t num_neighbors = k == 0 ? lat.size() : std::min(k, lat.size());
+		segregation::map::util::geodesic_coordinates<Type2> coordinates(lat, lon);
+
+		std::vector<double> running_sum, KLdivs;
+		std::vector<Type2>  distances, Xvalues;
+		std::vector<size_t> indexes;
+
+		#pragma omp parallel for schedule(dynamic) private(running_sum, KLdivs, distances, Xvalues, indexes)
+		for (size_t i = 0; i < lat.size(); ++i) {
+			distances.resize(lat.size());
+			segregation::map::util::get_distances_row(coordinates, i, std::span<Type2>(distances));
+			distances[i] = 0;
+
+			indexes.resize(lat.size());
+			std::iota(indexes.begin(), indexes.end(), 0);
+			std::partial_sort(indexes.begin(), indexes.begin() + num_neighbors, indexes.end(), [&distances](size_t i, size_t j) {
+				return distances[i] < distances[j];
+			});
+
+			std::span<const Type2> Xvalues_i;
+			if (use_distances) {
+				Xvalues.resize(num_neighbors);
+				for (size_t j = 0; j < num_neighbors; ++j) {
+					Xvalues[j] = distances[indexes[j]];
 				}
-			}, normalization_coef);
+				Xvalues_i = std::span<const Type2>(Xvalues);
+			}
+
+			distortion_coefs[i] = get_distortion_coef_single(vects, log2_total_distribution,
+				std::span<const size_t>(indexes.data(), num_neighbors), Xvalues_i, running_sum, KLdivs)/normalization_coef;
+		}
+
+		return distortion_coefs;
 	}
 
-	template<typename Type1, typename Type2=double>
-	Type1 get_normalization_factor(const std::vector<std::vector<Type1>> &vects, const std::vector<std::vector<Type2>> &Xvalues={}, bool is_reversed_order=false) {
+	template<typename Type1, class XMatrix=std::vector<std::vector<double>>>
+	Type1 get_normalization_factor(const std::vector<std::vector<Type1>> &vects, const XMatrix &Xvalues={}, bool is_reversed_order=false) {
+		typedef ::util::matrix::element_type<XMatrix> Type2;
+
 		std::vector<Type2> worst_Xvalues         = util::get_worst_Xvalues(Xvalues, vects[0].size(), is_reversed_order);
 		std::vector<Type1> worst_KLdiv_traj      = util::get_worst_KLdiv_trajectory(vects);
 		Type1              worst_distortion_coef = segregation::multiscalar::get_distortion_coefs_from_KLdiv(
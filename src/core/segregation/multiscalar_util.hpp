@@ -1,21 +1,30 @@
 #pragma once
 
 #include "../../util/math.hpp"
+#include "../../util/matrix.hpp"
 
 #include "multiscalar.hpp"
 
 
 namespace segregation::multiscalar::util {
+	/* the number of groups is tiny, so each group is summed by a parallel reduction over the nodes */
 	template<typename Type>
 	std::vector<Type> get_total_distribution(const std::vector<std::vector<Type>> &vects) {
-		std::vector<Type> total_distribution(vects.size());
+		std::vector<Type> total_distribution(vects.size(), 0);
 
 		Type total = 0;
-		#pragma omp parallel for
 		for (size_t k = 0; k < vects.size(); ++k) {
-			total_distribution[k] = std::accumulate(vects[k].begin(), vects[k].end(), 0);
-			#pragma omp critical
-			total                += total_distribution[k];
+			const Type *vect = vects[k].data();
+			const size_t n   = vects[k].size();
+
+			Type sum = 0;
+			#pragma omp parallel for simd reduction(+:sum)
+			for (size_t i = 0; i < n; ++i) {
+				sum += vect[i];
+			}
+
+			total_distribution[k] = sum;
+			total                += sum;
 		}
 		for (size_t k = 0; k < vects.size(); ++k) {
 			total_distribution[k] /= total;
@@ -24,37 +33,39 @@ namespace segregation::multiscalar::util {
 		return total_distribution;
 	}
 
+	/* each group is streamed contiguously, with the same static partition of the nodes for every group
+	so each thread only ever adds to its own range of total_population */
 	template<typename Type>
 	std::vector<Type> get_populations(const std::vector<std::vector<Type>> &vects) {
 		std::vector<Type> total_population(vects[0].size(), 0);
+		const size_t n = total_population.size();
 
-		Type total = 0;
-		#pragma omp parallel for
-		for (size_t i = 0; i < vects[0].size(); ++i) {
-			for (size_t k = 0; k < vects.size(); ++k) {
-				total_population[i] += vects[k][i];
+		#pragma omp parallel
+		for (size_t k = 0; k < vects.size(); ++k) {
+			const Type *vect = vects[k].data();
+
+			#pragma omp for simd schedule(static) nowait
+			for (size_t i = 0; i < n; ++i) {
+				total_population[i] += vect[i];
 			}
 		}
 
 		return total_population;
 	}
 	
-	template<typename Type>
-	std::vector<std::vector<Type>> get_accumulated_trajectory(const std::vector<std::vector<Type>> &vects, const std::vector<std::vector<size_t>> &indexes) {
-		std::vector<std::vector<Type>> accumulated_trajectory(indexes.size(),  std::vector<Type>(indexes[0].size()));
+	template<typename Type, class Indexes>
+	::util::matrix::Matrix<Type> get_accumulated_trajectory(const std::vector<std::vector<Type>> &vects, const Indexes &indexes) {
+		::util::matrix::Matrix<Type> accumulated_trajectory(::util::matrix::get_row_sizes(indexes));
 
 		#pragma omp parallel for
 		for (size_t i = 0; i < indexes.size(); ++i) {
-			accumulated_trajectory[i][0] = 0;
-
-			for (size_t j = 0; j < indexes[0].size(); ++j) {
-				if (j > 0) {
-					accumulated_trajectory[i][j] = accumulated_trajectory[i][j-1];
-				}
+			Type accumulated = 0;
 
+			for (size_t j = 0; j < indexes[i].size(); ++j) {
 				for (size_t k = 0; k < vects.size(); ++k) {
-					accumulated_trajectory[i][j] += vects[k][indexes[i][j]];
+					accumulated += vects[k][indexes[i][j]];
 				}
+				accumulated_trajectory[i][j] = accumulated;
 			}
 		}
 
@@ -66,11 +77,13 @@ namespace segregation::multiscalar::util {
 		return get_accumulated_trajectory(std::vector<std::vector<Type>>({vect}));
 	}
 
-	template<typename Type=double>
-	std::vector<Type> get_worst_Xvalues(const std::vector<std::vector<Type>> &Xvalues={}, size_t vect_size=0, bool is_reversed_order=false) {
+	template<class XMatrix=std::vector<std::vector<double>>>
+	std::vector<::util::matrix::element_type<XMatrix>> get_worst_Xvalues(const XMatrix &Xvalues={}, size_t vect_size=0, bool is_reversed_order=false) {
 		/* Get the X value trajectory,
 		the "worst trajectory" is the one where we encounter the furthest 1st node,
 		then the furhtest 2nd node, etc... */
+		typedef ::util::matrix::element_type<XMatrix> Type;
+
 		if (vect_size == 0) {
 			vect_size = Xvalues.size();
 		}
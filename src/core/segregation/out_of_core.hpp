@@ -0,0 +1,140 @@
+#pragma once
+
+#include "../../util/matrix.hpp"
+#include "../../util/mmap_util.hpp"
+
+#include "multiscalar.hpp"
+#include "multiscalar_util.hpp"
+#include "map_util.hpp"
+
+#include <algorithm>
+#include <utility>
+
+
+namespace segregation::multiscalar::out_of_core {
+	/* out-of-core versions of the multiscalar pipeline over file-backed matrices (util::mmap::mapped_matrix),
+	the rows being processed tile_size at a time and the pages of every finished tile being released,
+	so the resident memory stays bounded by a few tiles whatever the number of units */
+	template<class Func, class... Matrices>
+	void for_each_tile(size_t num_rows, size_t tile_size, const Func &func, Matrices&... matrices) {
+		tile_size = std::max((size_t)1, tile_size);
+
+		for (size_t begin = 0; begin < num_rows; begin += tile_size) {
+			const size_t end = std::min(num_rows, begin + tile_size);
+
+			func(begin, end);
+
+			(matrices.release(begin, end), ...);
+		}
+	}
+
+	/* distances (N x N) written directly to the file */
+	template<typename Type>
+	void get_distances(const std::vector<Type> &lat, const std::vector<Type> &lon, ::util::mmap::mapped_matrix<Type> &distances, size_t tile_size=1024) {
+		if (distances.num_rows() != lat.size() || distances.num_cols() != lat.size()) {
+			throw std::invalid_argument("in \"out_of_core::get_distances\", distances file doesn't have the shape N x N");
+		}
+
+		segregation::map::util::geodesic_coordinates<Type> coordinates(lat, lon);
+		::util::matrix::Matrix<Type> distances_matrix = distances.matrix();
+
+		for_each_tile(lat.size(), tile_size, [&](size_t begin, size_t end) {
+			#pragma omp parallel for schedule(dynamic)
+			for (size_t i = begin; i < end; ++i) {
+				segregation::map::util::get_distances_row(coordinates, i, distances_matrix[i]);
+				distances_matrix[i][i] = 0;
+			}
+		}, distances);
+	}
+
+	/* sorted neighbors indexes, only the indexes.num_cols() closest ones being kept (truncated mode) */
+	template<typename Type>
+	void get_closest_neighbors(::util::mmap::mapped_matrix<Type> &distances, ::util::mmap::mapped_matrix<size_t> &indexes, size_t tile_size=1024) {
+		if (indexes.num_rows() != distances.num_rows() || indexes.num_cols() > distances.num_cols()) {
+			throw std::invalid_argument("in \"out_of_core::get_closest_neighbors\", indexes file doesn't match the distances file");
+		}
+
+		const ::util::matrix::Matrix<Type> distances_matrix = std::as_const(distances).matrix();
+		::util::matrix::Matrix<size_t>     indexes_matrix   = indexes.matrix();
+
+		for_each_tile(distances.num_rows(), tile_size, [&](size_t begin, size_t end) {
+			::util::matrix::Matrix<size_t> tile_indexes = segregation::multiscalar::get_closest_neighbors(distances_matrix.rows(begin, end), indexes.num_cols());
+
+			std::copy(tile_indexes.data(), tile_indexes.data() + tile_indexes.num_elements(), indexes_matrix[begin].data());
+		}, distances, indexes);
+	}
+
+	/* KL-divergence trajectories (against the total distribution), trajectories only being computed for one tile at a time */
+	template<typename Type>
+	void get_KLdiv_trajectories(const std::vector<std::vector<Type>> &vects, ::util::mmap::mapped_matrix<size_t> &indexes, ::util::mmap::mapped_matrix<double> &KLdiv_trajectories,
+		size_t tile_size=1024, bool fast_log2=false)
+	{
+		if (KLdiv_trajectories.num_rows() != indexes.num_rows() || KLdiv_trajectories.num_cols() != indexes.num_cols()) {
+			throw std::invalid_argument("in \"out_of_core::get_KLdiv_trajectories\", KL-divergence file doesn't match the indexes file");
+		}
+
+		const std::vector<Type> total_distribution = segregation::multiscalar::util::get_total_distribution(vects);
+
+		const ::util::matrix::Matrix<size_t> indexes_matrix = std::as_const(indexes).matrix();
+		::util::matrix::Matrix<double>       KLdiv_matrix   = KLdiv_trajectories.matrix();
+
+		for_each_tile(indexes.num_rows(), tile_size, [&](size_t begin, size_t end) {
+			::util::matrix::Matrix<double> tile_KLdiv = segregation::multiscalar::get_KLdiv_trajectories(
+				segregation::multiscalar::get_trajectories(vects, indexes_matrix.rows(begin, end)),
+				total_distribution, fast_log2);
+
+			std::copy(tile_KLdiv.data(), tile_KLdiv.data() + tile_KLdiv.num_elements(), KLdiv_matrix[begin].data());
+		}, indexes, KLdiv_trajectories);
+	}
+
+	inline ::util::matrix::Matrix<size_t> get_focal_distance_indexes(::util::mmap::mapped_matrix<double> &KLdiv_trajectories, const std::vector<double> &convergence_thresholds, size_t tile_size=1024) {
+		::util::matrix::Matrix<size_t>       focal_distance_indexes(KLdiv_trajectories.num_rows(), convergence_thresholds.size());
+		const ::util::matrix::Matrix<double> KLdiv_matrix = std::as_const(KLdiv_trajectories).matrix();
+
+		for_each_tile(KLdiv_trajectories.num_rows(), tile_size, [&](size_t begin, size_t end) {
+			::util::matrix::Matrix<size_t> tile_indexes = segregation::multiscalar::get_focal_distance_indexes(KLdiv_matrix.rows(begin, end), convergence_thresholds);
+
+			std::copy(tile_indexes.data(), tile_indexes.data() + tile_indexes.num_elements(), focal_distance_indexes[begin].data());
+		}, KLdiv_trajectories);
+
+		return focal_distance_indexes;
+	}
+
+	template<typename Type2=double>
+	std::vector<double> get_distortion_coefs_from_KLdiv(::util::mmap::mapped_matrix<double> &KLdiv_trajectories, const Type2 &normalization_coef=1.d, size_t tile_size=1024) {
+		std::vector<double>                  distortion_coefs(KLdiv_trajectories.num_rows());
+		const ::util::matrix::Matrix<double> KLdiv_matrix = std::as_const(KLdiv_trajectories).matrix();
+
+		for_each_tile(KLdiv_trajectories.num_rows(), tile_size, [&](size_t begin, size_t end) {
+			std::vector<double> tile_distortion_coefs = segregation::multiscalar::get_distortion_coefs_from_KLdiv(
+				KLdiv_matrix.rows(begin, end), std::vector<std::vector<double>>{}, normalization_coef);
+
+			std::copy(tile_distortion_coefs.begin(), tile_distortion_coefs.end(), distortion_coefs.begin() + begin);
+		}, KLdiv_trajectories);
+
+		return distortion_coefs;
+	}
+
+	/* same with Xvalues (for example the sorted distances) stored in a file of the same shape */
+	template<typename Type1, typename Type2=double>
+	std::vector<Type1> get_distortion_coefs_from_KLdiv(::util::mmap::mapped_matrix<double> &KLdiv_trajectories, ::util::mmap::mapped_matrix<Type1> &Xvalues,
+		const Type2 &normalization_coef=1.d, size_t tile_size=1024)
+	{
+		if (Xvalues.num_rows() != KLdiv_trajectories.num_rows() || Xvalues.num_cols() != KLdiv_trajectories.num_cols()) {
+			throw std::invalid_argument("in \"out_of_core::get_distortion_coefs_from_KLdiv\", Xvalues file doesn't match the KL-divergence file");
+		}
+
+		std::vector<Type1>                   distortion_coefs(KLdiv_trajectories.num_rows());
+		const ::util::matrix::Matrix<double> KLdiv_matrix   = std::as_const(KLdiv_trajectories).matrix();
+		const ::util::matrix::Matrix<Type1>  Xvalues_matrix = std::as_const(Xvalues).matrix();
+
+		for_each_tile(KLdiv_trajectories.num_rows(), tile_size, [&](size_t begin, size_t end) {
+			std::vector<Type1> tile_distortion_coefs = segregation::multiscalar::get_distortion_coefs_from_KLdiv(
+				KLdiv_matrix.rows(begin, end), Xvalues_matrix.rows(begin, end), normalization_coef);
+
+			std::copy(tile_distortion_coefs.begin(), tile_distortion_coefs.end(), distortion_coefs.begin() + begin);
+		}, KLdiv_trajectories, Xvalues);
+
+		return distortion_coefs;
+	}
+}
@@ -2,6 +2,7 @@
 
 #include <random>
 #include <algorithm>
+#include <array>
 
 #include "../core/election.hpp"
 #include "../core/agent.hpp"
@@ -17,6 +18,8 @@ namespace BPsimulation::implem {
 	public:
 		Nvoter() {}
 
+		static const size_t num_possible_agents = N_candidates;
+
 		int candidate = 0;
 		
 		void randomize(const std::vector<double> &probas=std::vector<double>(N_candidates, 1.d)) {
@@ -46,20 +49,21 @@ namespace BPsimulation::implem {
 	template<int N_candidates>
 	class Nvoter_majority_election_result : public core::election::ElectionResultTemplate {
 	public:
-		std::vector<size_t> votes       = std::vector<size_t>(N_candidates, 0);
-		std::vector<double> proportions = std::vector<double>(N_candidates, 0.d);
+		std::array<size_t, N_candidates> votes       = {};
+		std::array<double, N_candidates> proportions = {};
 		int result;
 
 		Nvoter_majority_election_result() {};
-		ElectionResultTemplate& operator+=(const core::election::ElectionResultTemplate* other_) {
-			Nvoter_majority_election_result<N_candidates> *other = (Nvoter_majority_election_result<N_candidates>*)other_;
-
+		Nvoter_majority_election_result<N_candidates>& operator+=(const Nvoter_majority_election_result<N_candidates> &other) {
 			for (int icandidate = 0; icandidate < N_candidates; ++icandidate) {
-				votes[icandidate] += other->votes[icandidate];
+				votes[icandidate] += other.votes[icandidate];
 			}
 
 			return *this;
 		}
+		ElectionResultTemplate& operator+=(const core::election::ElectionResultTemplate* other_) {
+			return *this += *(const Nvoter_majority_election_result<N_candidates>*)other_;
+		}
 		ElectionResultTemplate& operator*=(size_t N) {
 			for (int icandidate = 0; icandidate < N_candidates; ++icandidate) {
 				votes[icandidate] *= N;
@@ -80,24 +84,30 @@ namespace BPsimulation::implem {
 	};
 
 	template<int N_candidates, class Agent>
-	class Nvoter_majority_election : public core::election::ElectionTemplate<Agent> {
+	class Nvoter_majority_election final : public core::election::ElectionTemplate<Agent> {
 	public:
+		typedef Nvoter_majority_election_result<N_candidates> result_type;
+
 		Nvoter_majority_election_result<N_candidates>* get_neutral_election_result() const {
 			return new Nvoter_majority_election_result<N_candidates>();
 		}
-		Nvoter_majority_election_result<N_candidates>* operator()(const Agent& agent) const {
-			Nvoter_majority_election_result<N_candidates> *result = new Nvoter_majority_election_result<N_candidates>();
-
-			result->votes[agent.candidate] = 1;
-
-			return result;
+		void accumulate(Nvoter_majority_election_result<N_candidates> &result, const Agent& agent, size_t N=1) const {
+			result.votes[agent.candidate] += N;
+		}
+		void accumulate(core::election::ElectionResultTemplate &result, const Agent& agent, size_t N=1) const {
+			accumulate((Nvoter_majority_election_result<N_candidates>&)result, agent, N);
+		}
+		core::election::ElectionResultTemplate* operator()(const Agent& agent) const {
+			return this->accumulate_to_neutral_result(agent);
 		}
 	};
 
 	template<int N_candidates>
-	class Nvoter_interaction_function : public core::agent::AgentInteractionFunctionTemplate<Nvoter<N_candidates>> {
+	class Nvoter_interaction_function final : public core::agent::AgentInteractionFunctionTemplate<Nvoter<N_candidates>> {
 	public:
-		void operator()(Nvoter<N_candidates> &agent, std::vector<std::pair<const Nvoter<N_candidates>*, double>> neighbors) const {
+		bool uses_random_select() const { return true; }
+
+		void operator()(Nvoter<N_candidates> &agent, core::agent::NeighborView<Nvoter<N_candidates>> neighbors) const {
 			const Nvoter<N_candidates>* neighbor = core::agent::AgentInteractionFunctionTemplate<Nvoter<N_candidates>>::random_select(neighbors);
 			agent.candidate = neighbor->candidate;
 		}
@@ -142,6 +152,7 @@ namespace BPsimulation::implem {
 	class NVoterSerializer : public core::agent::AgentSerializerTemplate<Nvoter<N_candidates>> {
 	public:
 		typedef std::variant<bool, int, unsigned int, long, size_t, float, double> variable_type;
+		typedef typename core::agent::AgentSerializerTemplate<Nvoter<N_candidates>>::column_type column_type;
 
 		std::vector<std::pair<std::string, int>> list_of_fields() const {
 			return {
@@ -158,5 +169,22 @@ namespace BPsimulation::implem {
 		void read(Nvoter<N_candidates> &agent, const std::vector<variable_type> &values) const {
 			agent.candidate = std::get<int>(values[0]);
 		}
+
+		void write_columns(std::span<const Nvoter<N_candidates>> agents, std::vector<column_type> &columns) const {
+			std::span<int> candidate = this->template column<int>(columns[0]);
+
+			#pragma omp parallel for
+			for (size_t node = 0; node < agents.size(); ++node) {
+				candidate[node] = agents[node].candidate;
+			}
+		}
+		void read_columns(std::span<Nvoter<N_candidates>> agents, const std::vector<column_type> &columns) const {
+			std::span<const int> candidate = this->template column<int>(columns[0]);
+
+			#pragma omp parallel for
+			for (size_t node = 0; node < agents.size(); ++node) {
+				agents[node].candidate = candidate[node];
+			}
+		}
 	};
 }
\ No newline at end of file
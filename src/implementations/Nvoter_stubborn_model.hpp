@@ -21,6 +21,8 @@ namespace BPsimulation::implem {
 	public:
 		Nvoter_stubborn() {}
 
+		static const size_t num_possible_agents = 2*N_candidates;
+
 		bool stubborn=false;
 
 		template<typename ...Args>
@@ -46,11 +48,13 @@ namespace BPsimulation::implem {
 	};
 
 	template<int N_candidates>
-	class Nvoter_stubborn_interaction_function : public core::agent::AgentInteractionFunctionTemplate<Nvoter_stubborn<N_candidates>> {
+	class Nvoter_stubborn_interaction_function final : public core::agent::AgentInteractionFunctionTemplate<Nvoter_stubborn<N_candidates>> {
 	public:
-		void operator()(Nvoter_stubborn<N_candidates> &agent, std::vector<std::pair<const Nvoter_stubborn<N_candidates>*, double>> neighbors) const {
+		bool uses_random_select() const { return true; }
+
+		void operator()(Nvoter_stubborn<N_candidates> &agent, core::agent::NeighborView<Nvoter_stubborn<N_candidates>> neighbors) const {
 			if (!agent.stubborn) {
-				const Nvoter_stubborn<N_candidates>* neighbor = random_select(neighbors);
+				const Nvoter_stubborn<N_candidates>* neighbor = core::agent::AgentInteractionFunctionTemplate<Nvoter_stubborn<N_candidates>>::random_select(neighbors);
 				agent.candidate = neighbor->candidate;
 			}
 		}
@@ -60,6 +64,7 @@ namespace BPsimulation::implem {
 	class NVoterstubbornSerializer : public core::agent::AgentSerializerTemplate<Nvoter_stubborn<N_candidates>> {
 	public:
 		typedef std::variant<bool, int, unsigned int, long, size_t, float, double> variable_type;
+		typedef typename core::agent::AgentSerializerTemplate<Nvoter_stubborn<N_candidates>>::column_type column_type;
 
 		std::vector<std::pair<std::string, int>> list_of_fields() const {
 			return {
@@ -68,7 +73,7 @@ namespace BPsimulation::implem {
 			};
 		}
 		std::vector<variable_type> write(const Nvoter_stubborn<N_candidates> &agent) const {
-			std::vector<variable_type> values(1);
+			std::vector<variable_type> values(2);
 			
 			values[0] = agent.candidate;
 			values[1] = agent.stubborn;
@@ -79,5 +84,26 @@ namespace BPsimulation::implem {
 			agent.candidate = std::get<int >(values[0]);
 			agent.stubborn   = std::get<bool>(values[1]);
 		}
+
+		void write_columns(std::span<const Nvoter_stubborn<N_candidates>> agents, std::vector<column_type> &columns) const {
+			std::span<int>  candidate = this->template column<int >(columns[0]);
+			std::span<char> stubborn  = this->template column<char>(columns[1]);
+
+			#pragma omp parallel for
+			for (size_t node = 0; node < agents.size(); ++node) {
+				candidate[node] = agents[node].candidate;
+				stubborn[ node] = agents[node].stubborn;
+			}
+		}
+		void read_columns(std::span<Nvoter_stubborn<N_candidates>> agents, const std::vector<column_type> &columns) const {
+			std::span<const int>  candidate = this->template column<int >(columns[0]);
+			std::span<const char> stubborn  = this->template column<char>(columns[1]);
+
+			#pragma omp parallel for
+			for (size_t node = 0; node < agents.size(); ++node) {
+				agents[node].candidate = candidate[node];
+				agents[node].stubborn  = stubborn[ node];
+			}
+		}
 	};
 }
\ No newline at end of file
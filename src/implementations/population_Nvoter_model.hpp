@@ -1,6 +1,7 @@
 #pragma once
 
 #include <random>
+#include <array>
 
 #include "../core/agent_population/agent_population.hpp"
 #include "Nvoter_model.hpp"
@@ -10,19 +11,19 @@
 
 namespace BPsimulation::implem {
 	template<int N_candidates>
-	class population_Nvoter_interaction_function : public core::agent::AgentInteractionFunctionTemplate<core::agent::population::AgentPopulation<Nvoter<N_candidates>>> {
+	class population_Nvoter_interaction_function final : public core::agent::AgentInteractionFunctionTemplate<core::agent::population::AgentPopulation<Nvoter<N_candidates>>> {
 	public:
 		size_t N_select;
 		population_Nvoter_interaction_function(size_t N_select_) : N_select(N_select_) {}
 
 		void operator()(core::agent::population::AgentPopulation<Nvoter<N_candidates>> &agent,
-			std::vector<std::pair<const core::agent::population::AgentPopulation<Nvoter<N_candidates>>*, double>> neighbors) const
+			core::agent::NeighborView<core::agent::population::AgentPopulation<Nvoter<N_candidates>>> neighbors) const
 		{
 			if (agent.population > 0) {
-				std::vector<double> self_selected         = agent.random_select_self(N_select);
-				std::vector<double> neighborhood_selected = agent.random_select(     N_select, neighbors, false);
+				std::array<double, N_candidates> self_selected         = agent.random_select_self(N_select);
+				std::array<double, N_candidates> neighborhood_selected = agent.random_select(     N_select, neighbors, false);
 
-				std::vector<double> population_delta(N_candidates, 0);
+				std::array<double, N_candidates> population_delta;
 				for (int icandidate = 0; icandidate < N_candidates; ++icandidate) {
 					population_delta[icandidate] = neighborhood_selected[icandidate] - self_selected[icandidate];
 				}
@@ -1,9 +1,10 @@
 #pragma once
 
 #include <random>
+#include <array>
 
 #include "../core/agent_population/agent_population.hpp"
-#include "voter_model_stubborn.hpp"
+#include "Nvoter_stubborn_model.hpp"
 
 #include "../util/util.hpp"
 
@@ -12,7 +13,7 @@ namespace BPsimulation::implem {
 	template<int N_candidates>
 	class AgentPopulationNVoterstubborn : public core::agent::population::AgentPopulation<Nvoter_stubborn<N_candidates>> {
 	public:
-		std::vector<double> stubborn_equilibrium = std::vector<double>(N_candidates, 0.d);
+		std::array<double, N_candidates> stubborn_equilibrium = {};
 
 		template<typename ...Args>
 		void randomize(const std::vector<double> &mean_equilibirum, const std::vector<double> &equilibrium_var, Args ...args) {
@@ -47,10 +48,10 @@ namespace BPsimulation::implem {
 	};
 
 	template<int N_candidates>
-	class population_Nvoter_stubborn_interaction_function : public core::agent::AgentInteractionFunctionTemplate<core::agent::population::AgentPopulation<Nvoter_stubborn<N_candidates>>> {
+	class population_Nvoter_stubborn_interaction_function final : public core::agent::AgentInteractionFunctionTemplate<core::agent::population::AgentPopulation<Nvoter_stubborn<N_candidates>>> {
 	private:
-		const std::vector<size_t> exclude_idx = []() {
-			std::vector<size_t> exclude_idx_(N_candidates);
+		static constexpr std::array<size_t, N_candidates> exclude_idx = []() {
+			std::array<size_t, N_candidates> exclude_idx_;
 			std::iota(exclude_idx_.begin(), exclude_idx_.end(), N_candidates);
 
 			return exclude_idx_;
@@ -60,13 +61,13 @@ namespace BPsimulation::implem {
 		population_Nvoter_stubborn_interaction_function(size_t N_select_) : N_select(N_select_) {}
 
 		void operator()(core::agent::population::AgentPopulation<Nvoter_stubborn<N_candidates>> &agent,
-			std::vector<std::pair<const core::agent::population::AgentPopulation<Nvoter_stubborn<N_candidates>>*, double>> neighbors) const
+			core::agent::NeighborView<core::agent::population::AgentPopulation<Nvoter_stubborn<N_candidates>>> neighbors) const
 		{
 			if (agent.population > 0) {
-				std::vector<double> self_selected         = agent.random_select_self(N_select, exclude_idx);
-				std::vector<double> neighborhood_selected = agent.random_select(     N_select, neighbors, false);
+				std::array<double, 2*N_candidates> self_selected         = agent.random_select_self(N_select, exclude_idx);
+				std::array<double, 2*N_candidates> neighborhood_selected = agent.random_select(     N_select, neighbors, false);
 
-				std::vector<double> population_delta(2*N_candidates, 0);
+				std::array<double, 2*N_candidates> population_delta = {};
 				for (int icandidate = 0; icandidate < N_candidates; ++icandidate) {
 					population_delta[icandidate] = neighborhood_selected[icandidate] + neighborhood_selected[N_candidates+icandidate] - self_selected[icandidate];
 				}
@@ -77,13 +78,13 @@ namespace BPsimulation::implem {
 	};
 
 	template<int N_candidates>
-	class Nvoter_stubborn_equilibirum_function : public core::agent::AgentWiseUpdateFunctionTemplate<AgentPopulationNVoterstubborn<N_candidates>> {
+	class Nvoter_stubborn_equilibirum_function final : public core::agent::AgentWiseUpdateFunctionTemplate<AgentPopulationNVoterstubborn<N_candidates>> {
 	public:
 		double dt;
 
 		Nvoter_stubborn_equilibirum_function(double dt_=0.1) : dt(dt_) {}
 		void operator()(AgentPopulationNVoterstubborn<N_candidates> &agent) const {
-			std::vector<double> proportions_variations(2*N_candidates, 0.d);
+			std::array<double, 2*N_candidates> proportions_variations = {};
 			for (int icandidate = 0; icandidate < N_candidates; ++icandidate) {
 				double radicalization_flux = std::max(agent.proportions[N_candidates+icandidate]-1, std::min(agent.proportions[icandidate],
 					dt*(agent.proportions[icandidate]*agent.stubborn_equilibrium[icandidate] - agent.proportions[N_candidates+icandidate])));
@@ -97,7 +98,7 @@ namespace BPsimulation::implem {
 	};
 
 	template<int N_candidates>
-	class Nvoter_stubborn_overtoon_effect : public core::election::ElectionRetroinfluenceTemplate<AgentPopulationNVoterstubborn<N_candidates>> {
+	class Nvoter_stubborn_overtoon_effect final : public core::election::ElectionRetroinfluenceTemplate<AgentPopulationNVoterstubborn<N_candidates>> {
 	private:
 		inline double overtoon_distance(double distance) const {
 			double normalized_distance = std::abs(distance/((double)N_candidates));
@@ -123,7 +124,7 @@ namespace BPsimulation::implem {
 				mean_political_position          += icandidate*          (agent.proportions[icandidate] + agent.proportions[N_candidates+icandidate]);
 			}
 
-			std::vector<double> proportions_variations(2*N_candidates, 0.d);
+			std::array<double, 2*N_candidates> proportions_variations = {};
 			for (int icandidate = 0; icandidate < N_candidates; ++icandidate) {
 				double flux                = dt*multiplier*overtoon_distance(icandidate - election_mean_political_position);
 				double radicalization_flux = radicalization_multiplier*flux;
@@ -157,7 +158,7 @@ namespace BPsimulation::implem {
 	};
 
 	template<int N_candidates>
-	class Nvoter_stubborn_frustration_effect : public core::election::ElectionRetroinfluenceTemplate<AgentPopulationNVoterstubborn<N_candidates>> {
+	class Nvoter_stubborn_frustration_effect final : public core::election::ElectionRetroinfluenceTemplate<AgentPopulationNVoterstubborn<N_candidates>> {
 	public:
 		double dt, multiplier; 
 		
@@ -165,7 +166,7 @@ namespace BPsimulation::implem {
 		void operator()(AgentPopulationNVoterstubborn<N_candidates>& agent, const core::election::ElectionResultTemplate* election_result_) const {
 			Nvoter_majority_election_result<N_candidates> *election_result = (Nvoter_majority_election_result<N_candidates>*)election_result_;
 
-			std::vector<double> proportions_variations(2*N_candidates, 0.d);
+			std::array<double, 2*N_candidates> proportions_variations = {};
 			for (int icandidate = 0; icandidate < N_candidates; ++icandidate) {
 				if (election_result->result != icandidate) {
 					double radicalization_flux = dt*multiplier*agent.proportions[icandidate];
@@ -186,6 +187,7 @@ namespace BPsimulation::implem {
 
 	public:
 		typedef std::variant<bool, int, unsigned int, long, size_t, float, double> variable_type;
+		typedef typename core::agent::AgentSerializerTemplate<AgentPopulationNVoterstubborn<N_candidates>>::column_type column_type;
 		std::vector<std::pair<std::string, int>> list_of_fields() const {
 			std::vector<std::pair<std::string, int>> list_of_fields_ = partial_serializer.list_of_fields();
 
@@ -212,6 +214,37 @@ namespace BPsimulation::implem {
 				agent.stubborn_equilibrium[icandidate] = std::get<double>(values[1+2*N_candidates+icandidate]);
 			}
 		}
+
+		void write_columns(std::span<const AgentPopulationNVoterstubborn<N_candidates>> agents, std::vector<column_type> &columns) const {
+			partial_serializer.write_population_columns(agents, columns);
+
+			std::array<std::span<double>, N_candidates> stubborn_equilibrium;
+			for (int icandidate = 0; icandidate < N_candidates; ++icandidate) {
+				stubborn_equilibrium[icandidate] = this->template column<double>(columns[1+2*N_candidates+icandidate]);
+			}
+
+			#pragma omp parallel for
+			for (size_t node = 0; node < agents.size(); ++node) {
+				for (int icandidate = 0; icandidate < N_candidates; ++icandidate) {
+					stubborn_equilibrium[icandidate][node] = agents[node].stubborn_equilibrium[icandidate];
+				}
+			}
+		}
+		void read_columns(std::span<AgentPopulationNVoterstubborn<N_candidates>> agents, const std::vector<column_type> &columns) const {
+			partial_serializer.read_population_columns(agents, columns);
+
+			std::array<std::span<const double>, N_candidates> stubborn_equilibrium;
+			for (int icandidate = 0; icandidate < N_candidates; ++icandidate) {
+				stubborn_equilibrium[icandidate] = this->template column<double>(columns[1+2*N_candidates+icandidate]);
+			}
+
+			#pragma omp parallel for
+			for (size_t node = 0; node < agents.size(); ++node) {
+				for (int icandidate = 0; icandidate < N_candidates; ++icandidate) {
+					agents[node].stubborn_equilibrium[icandidate] = stubborn_equilibrium[icandidate][node];
+				}
+			}
+		}
 	};
 
 	namespace util {
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <random>
+#include <array>
 
 #include "../core/agent_population/agent_population.hpp"
 #include "voter_model_stubborn.hpp"
@@ -11,7 +12,7 @@
 namespace BPsimulation::implem {
 	class AgentPopulationVoterstubborn : public core::agent::population::AgentPopulation<voter_stubborn> {
 	public:
-		double stubborn_equilibrium[2] = {0, 0};
+		std::array<double, 2> stubborn_equilibrium = {0, 0};
 
 		template<typename ...Args>
 		void randomize(double mean_stubborn_equilibrium0, double mean_stubborn_equilibrium1, Args ...args) {
@@ -27,17 +28,19 @@ namespace BPsimulation::implem {
 		}
 	};
 
-	class population_voter_stubborn_interaction_function : public core::agent::AgentInteractionFunctionTemplate<core::agent::population::AgentPopulation<voter_stubborn>> {
+	class population_voter_stubborn_interaction_function final : public core::agent::AgentInteractionFunctionTemplate<core::agent::population::AgentPopulation<voter_stubborn>> {
+	private:
+		static constexpr std::array<size_t, 2> exclude_idx = {2, 3};
 	public:
 		size_t N_select;
 		population_voter_stubborn_interaction_function(size_t N_select_) : N_select(N_select_) {}
 
 		void operator()(core::agent::population::AgentPopulation<voter_stubborn> &agent,
-			std::vector<std::pair<const core::agent::population::AgentPopulation<voter_stubborn>*, double>> neighbors) const
+			core::agent::NeighborView<core::agent::population::AgentPopulation<voter_stubborn>> neighbors) const
 		{
 			if (agent.population > 0) {
-				std::vector<double> self_selected         = agent.random_select_self(N_select, {2, 3});
-				std::vector<double> neighborhood_selected = agent.random_select(     N_select, neighbors, false);
+				std::array<double, 4> self_selected         = agent.random_select_self(N_select, exclude_idx);
+				std::array<double, 4> neighborhood_selected = agent.random_select(     N_select, neighbors, false);
 
 				agent.integrate_population_variation({
 					neighborhood_selected[0] + neighborhood_selected[2] - self_selected[0],
@@ -48,7 +51,7 @@ namespace BPsimulation::implem {
 		}
 	};
 
-	class voter_stubborn_equilibirum_function : public core::agent::AgentWiseUpdateFunctionTemplate<AgentPopulationVoterstubborn> {
+	class voter_stubborn_equilibirum_function final : public core::agent::AgentWiseUpdateFunctionTemplate<AgentPopulationVoterstubborn> {
 	public:
 		double dt;
 
@@ -67,7 +70,7 @@ namespace BPsimulation::implem {
 		}
 	};
 
-	class voter_stubborn_overtoon_effect : public core::election::ElectionRetroinfluenceTemplate<AgentPopulationVoterstubborn> {
+	class voter_stubborn_overtoon_effect final : public core::election::ElectionRetroinfluenceTemplate<AgentPopulationVoterstubborn> {
 	private:
 		inline double overtoon_distance(double distance) const {
 			double normalized_distance = 2*std::abs(distance) - 1;
@@ -110,7 +113,7 @@ namespace BPsimulation::implem {
 		}
 	};
 
-	class voter_stubborn_frustration_effect : public core::election::ElectionRetroinfluenceTemplate<AgentPopulationVoterstubborn> {
+	class voter_stubborn_frustration_effect final : public core::election::ElectionRetroinfluenceTemplate<AgentPopulationVoterstubborn> {
 	public:
 		double dt, multiplier; 
 		
@@ -166,5 +169,30 @@ namespace BPsimulation::implem {
 			agent.stubborn_equilibrium[0] = std::get<double>(values[5]);
 			agent.stubborn_equilibrium[1] = std::get<double>(values[6]);
 		}
+
+		void write_columns(std::span<const AgentPopulationVoterstubborn> agents, std::vector<column_type> &columns) const {
+			partial_serializer.write_population_columns(agents, columns);
+
+			std::span<double> stubborn_equilibrium_false = column<double>(columns[5]);
+			std::span<double> stubborn_equilibrium_true  = column<double>(columns[6]);
+
+			#pragma omp parallel for
+			for (size_t node = 0; node < agents.size(); ++node) {
+				stubborn_equilibrium_false[node] = agents[node].stubborn_equilibrium[0];
+				stubborn_equilibrium_true[ node] = agents[node].stubborn_equilibrium[1];
+			}
+		}
+		void read_columns(std::span<AgentPopulationVoterstubborn> agents, const std::vector<column_type> &columns) const {
+			partial_serializer.read_population_columns(agents, columns);
+
+			std::span<const double> stubborn_equilibrium_false = column<double>(columns[5]);
+			std::span<const double> stubborn_equilibrium_true  = column<double>(columns[6]);
+
+			#pragma omp parallel for
+			for (size_t node = 0; node < agents.size(); ++node) {
+				agents[node].stubborn_equilibrium[0] = stubborn_equilibrium_false[node];
+				agents[node].stubborn_equilibrium[1] = stubborn_equilibrium_true[ node];
+			}
+		}
 	};
 }
\ No newline at end of file
@@ -15,6 +15,8 @@ namespace BPsimulation::implem {
 	public:
 		voter() {}
 
+		static const size_t num_possible_agents = 2;
+
 		bool candidate = false;
 		
 		void randomize(float p=0.5) {
@@ -38,13 +40,14 @@ namespace BPsimulation::implem {
 		float proportion;
 
 		voter_majority_election_result() {};
-		core::election::ElectionResultTemplate& operator+=(const core::election::ElectionResultTemplate* other_) {
-			voter_majority_election_result *other = (voter_majority_election_result*)other_;
-
-			vote_True  += other->vote_True;
-			vote_False += other->vote_False;
+		voter_majority_election_result& operator+=(const voter_majority_election_result &other) {
+			vote_True  += other.vote_True;
+			vote_False += other.vote_False;
 			return *this;
 		}
+		core::election::ElectionResultTemplate& operator+=(const core::election::ElectionResultTemplate* other_) {
+			return *this += *(const voter_majority_election_result*)other_;
+		}
 		core::election::ElectionResultTemplate& operator*=(size_t N) {
 			vote_True  *= N;
 			vote_False *= N;
@@ -58,24 +61,30 @@ namespace BPsimulation::implem {
 	};
 
 	template<class Agent>
-	class voter_majority_election : public core::election::ElectionTemplate<Agent> {
+	class voter_majority_election final : public core::election::ElectionTemplate<Agent> {
 	public:
+		typedef voter_majority_election_result result_type;
+
 		voter_majority_election_result* get_neutral_election_result() const {
 			return new voter_majority_election_result();
 		}
-		voter_majority_election_result* operator()(const Agent& agent) const {
-			voter_majority_election_result *result = new voter_majority_election_result();
-
-			result->vote_True  =  agent.candidate;
-			result->vote_False = !agent.candidate;
-
-			return result;
+		void accumulate(voter_majority_election_result &result, const Agent& agent, size_t N=1) const {
+			result.vote_True  += N*( agent.candidate);
+			result.vote_False += N*(!agent.candidate);
+		}
+		void accumulate(core::election::ElectionResultTemplate &result, const Agent& agent, size_t N=1) const {
+			accumulate((voter_majority_election_result&)result, agent, N);
+		}
+		core::election::ElectionResultTemplate* operator()(const Agent& agent) const {
+			return this->accumulate_to_neutral_result(agent);
 		}
 	};
 
-	class voter_interaction_function : public core::agent::AgentInteractionFunctionTemplate<voter> {
+	class voter_interaction_function final : public core::agent::AgentInteractionFunctionTemplate<voter> {
 	public:
-		void operator()(voter &agent, std::vector<std::pair<const voter*, double>> neighbors) const {
+		bool uses_random_select() const { return true; }
+
+		void operator()(voter &agent, core::agent::NeighborView<voter> neighbors) const {
 			const voter* neighbor = random_select(neighbors);
 			agent.candidate = neighbor->candidate;
 		}
@@ -121,5 +130,22 @@ namespace BPsimulation::implem {
 		void read(voter &agent, const std::vector<variable_type> &values) const {
 			agent.candidate = std::get<bool>(values[0]);
 		}
+
+		void write_columns(std::span<const voter> agents, std::vector<column_type> &columns) const {
+			std::span<char> candidate = column<char>(columns[0]);
+
+			#pragma omp parallel for
+			for (size_t node = 0; node < agents.size(); ++node) {
+				candidate[node] = agents[node].candidate;
+			}
+		}
+		void read_columns(std::span<voter> agents, const std::vector<column_type> &columns) const {
+			std::span<const char> candidate = column<char>(columns[0]);
+
+			#pragma omp parallel for
+			for (size_t node = 0; node < agents.size(); ++node) {
+				agents[node].candidate = candidate[node];
+			}
+		}
 	};
 }
\ No newline at end of file
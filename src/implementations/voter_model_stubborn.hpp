@@ -16,6 +16,8 @@ namespace BPsimulation::implem {
 	public:
 		voter_stubborn() {}
 
+		static const size_t num_possible_agents = 4;
+
 		bool stubborn=false;
 		
 		void randomize(float p=0.5, float p_stubborn=0) {
@@ -35,9 +37,11 @@ namespace BPsimulation::implem {
 		}
 	};
 
-	class voter_stubborn_interaction_function : public core::agent::AgentInteractionFunctionTemplate<voter_stubborn> {
+	class voter_stubborn_interaction_function final : public core::agent::AgentInteractionFunctionTemplate<voter_stubborn> {
 	public:
-		void operator()(voter_stubborn &agent, std::vector<std::pair<const voter_stubborn*, double>> neighbors) const {
+		bool uses_random_select() const { return true; }
+
+		void operator()(voter_stubborn &agent, core::agent::NeighborView<voter_stubborn> neighbors) const {
 			if (!agent.stubborn) {
 				const voter_stubborn* neighbor = random_select(neighbors);
 				agent.candidate = neighbor->candidate;
@@ -51,15 +55,16 @@ namespace BPsimulation::implem {
 		float proportions[4] = {0, 0, 0, 0};
 
 		voter_stubborness_result() {};
-		core::election::ElectionResultTemplate& operator+=(const core::election::ElectionResultTemplate* other_) {
-			voter_stubborness_result *other = (voter_stubborness_result*)other_;
-
-			candidate0_notstubborn += other->candidate0_notstubborn;
-			candidate1_notstubborn += other->candidate1_notstubborn;
-			candidate0_stubborn    += other->candidate0_stubborn;
-			candidate1_stubborn    += other->candidate1_stubborn;
+		voter_stubborness_result& operator+=(const voter_stubborness_result &other) {
+			candidate0_notstubborn += other.candidate0_notstubborn;
+			candidate1_notstubborn += other.candidate1_notstubborn;
+			candidate0_stubborn    += other.candidate0_stubborn;
+			candidate1_stubborn    += other.candidate1_stubborn;
 			return *this;
 		}
+		core::election::ElectionResultTemplate& operator+=(const core::election::ElectionResultTemplate* other_) {
+			return *this += *(const voter_stubborness_result*)other_;
+		}
 		ElectionResultTemplate& operator*=(size_t N) {
 			candidate0_notstubborn *= N;
 			candidate1_notstubborn *= N;
@@ -77,20 +82,24 @@ namespace BPsimulation::implem {
 
 	};
 
-	class voter_stubborness_election : public core::election::ElectionTemplate<voter_stubborn> {
+	class voter_stubborness_election final : public core::election::ElectionTemplate<voter_stubborn> {
 	public:
+		typedef voter_stubborness_result result_type;
+
 		voter_stubborness_result* get_neutral_election_result() const {
 			return new voter_stubborness_result();
 		}
-		voter_stubborness_result* operator()(const voter_stubborn& agent) const {
-			voter_stubborness_result *result = new voter_stubborness_result();
-
-			result->candidate0_notstubborn = (!agent.candidate) && (!agent.stubborn);
-			result->candidate1_notstubborn =   agent.candidate  && (!agent.stubborn);
-			result->candidate0_stubborn    = (!agent.candidate) &&   agent.stubborn;
-			result->candidate1_stubborn    =   agent.candidate  &&   agent.stubborn;
-
-			return result;
+		void accumulate(voter_stubborness_result &result, const voter_stubborn& agent, size_t N=1) const {
+			result.candidate0_notstubborn += N*((!agent.candidate) && (!agent.stubborn));
+			result.candidate1_notstubborn += N*(  agent.candidate  && (!agent.stubborn));
+			result.candidate0_stubborn    += N*((!agent.candidate) &&   agent.stubborn);
+			result.candidate1_stubborn    += N*(  agent.candidate  &&   agent.stubborn);
+		}
+		void accumulate(core::election::ElectionResultTemplate &result, const voter_stubborn& agent, size_t N=1) const {
+			accumulate((voter_stubborness_result&)result, agent, N);
+		}
+		core::election::ElectionResultTemplate* operator()(const voter_stubborn& agent) const {
+			return this->accumulate_to_neutral_result(agent);
 		}
 	};
 
@@ -114,5 +123,26 @@ namespace BPsimulation::implem {
 			agent.candidate = std::get<bool>(values[0]);
 			agent.stubborn   = std::get<bool>(values[1]);
 		}
+
+		void write_columns(std::span<const voter_stubborn> agents, std::vector<column_type> &columns) const {
+			std::span<char> candidate = column<char>(columns[0]);
+			std::span<char> stubborn  = column<char>(columns[1]);
+
+			#pragma omp parallel for
+			for (size_t node = 0; node < agents.size(); ++node) {
+				candidate[node] = agents[node].candidate;
+				stubborn[ node] = agents[node].stubborn;
+			}
+		}
+		void read_columns(std::span<voter_stubborn> agents, const std::vector<column_type> &columns) const {
+			std::span<const char> candidate = column<char>(columns[0]);
+			std::span<const char> stubborn  = column<char>(columns[1]);
+
+			#pragma omp parallel for
+			for (size_t node = 0; node < agents.size(); ++node) {
+				agents[node].candidate = candidate[node];
+				agents[node].stubborn  = stubborn[ node];
+			}
+		}
 	};
 }
\ No newline at end of file
@@ -2,6 +2,10 @@
 
 #include "H5Cpp.h"
 
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
 
 namespace util::hdf5io {
 	H5::H5File open_truncate_if_needed(const char* filename) {
@@ -77,9 +81,9 @@ namespace util::hdf5io {
 	void H5WriteVector(H5::Group &group, const std::vector<Type> &data, const char* data_name) {
 		hsize_t dim[1] = { data.size() };
 	    H5::DataSpace dataspace = H5::DataSpace(1, dim);
-	    H5::DataSet   dataset   = group.createDataSet(data_name, H5DataType(data[0]), dataspace);
+	    H5::DataSet   dataset   = group.createDataSet(data_name, H5DataType(Type()), dataspace);
 
-	    dataset.write(data.data(), H5DataType(data[0]));
+	    dataset.write(data.data(), H5DataType(Type()));
 	    dataset.close();
 	}
 	template<class Type>
@@ -91,19 +95,23 @@ namespace util::hdf5io {
 	    dataspace.getSimpleExtentDims(dims, NULL);
 
 	    data.resize(dims[0]);
-	    dataset.read(data.data(), H5DataType(data[0]), dataspace);
+	    dataset.read(data.data(), H5DataType(Type()), dataspace);
 	    dataset.close();
 	}
 
 	template<class Type>
-	void H5WriteIrregular2DVector(H5::Group &group, const std::vector<std::vector<Type>> &data, const char* data_name) {
+	void H5WriteFlattened2DVector(H5::Group &group, const std::vector<size_t> &begin_end_idx, const std::vector<Type> &flattend_data, const char* data_name) {
 		std::string begin_end_idx_name = std::string(data_name) + "_begin_end_idx";
 
+		H5WriteVector(group, begin_end_idx, begin_end_idx_name.c_str());
+		H5WriteVector(group, flattend_data, data_name);
+	}
+	template<class Type>
+	void H5WriteIrregular2DVector(H5::Group &group, const std::vector<std::vector<Type>> &data, const char* data_name) {
 		std::vector<size_t> begin_end_idx(data.size()+1, 0);
 		for (size_t i = 0; i < data.size(); ++i) {
 			begin_end_idx[i + 1] = begin_end_idx[i] + data[i].size();
 		}
-		H5WriteVector(group, begin_end_idx, begin_end_idx_name.c_str());
 
 		std::vector<Type> flattend_data(begin_end_idx.back());
 		for (size_t i = 0; i < data.size(); ++i) {
@@ -111,7 +119,7 @@ namespace util::hdf5io {
 				flattend_data[begin_end_idx[i] + j] = data[i][j];
 			}
 		}
-		H5WriteVector(group, flattend_data, data_name);
+		H5WriteFlattened2DVector(group, begin_end_idx, flattend_data, data_name);
 	}
 	template<class Type>
 	void H5ReadIrregular2DVector(H5::Group &group, std::vector<std::vector<Type>> &data, const char* data_name) {
@@ -132,4 +140,105 @@ namespace util::hdf5io {
 			}
 		}
 	}
+
+
+	/* chunking and filters of the extensible (time, node) datasets.
+	chunk_cols == 0 uses whole rows of at most 65536 elements, deflate_level < 0 disables compression */
+	struct H5ChunkOptions {
+		hsize_t chunk_rows    = 1;
+		hsize_t chunk_cols    = 0;
+		int     deflate_level = -1;
+		bool    shuffle       = false;
+	};
+
+	template<class Type>
+	H5::DataSet H5CreateExtensible2D(H5::Group &group, hsize_t num_cols, const char* data_name, const H5ChunkOptions &options={}) {
+		hsize_t dims[2]     = { 0,             num_cols };
+		hsize_t max_dims[2] = { H5S_UNLIMITED, num_cols };
+		hsize_t chunk[2]    = {
+			std::max<hsize_t>(1, options.chunk_rows),
+			std::max<hsize_t>(1, std::min<hsize_t>(num_cols, options.chunk_cols == 0 ? 65536 : options.chunk_cols))
+		};
+
+		H5::DSetCreatPropList properties;
+		properties.setChunk(2, chunk);
+		if (options.shuffle) {
+			properties.setShuffle();
+		}
+		if (options.deflate_level >= 0) {
+			properties.setDeflate(options.deflate_level);
+		}
+
+		H5::DataSpace dataspace(2, dims, max_dims);
+		return group.createDataSet(data_name, H5DataType(Type()), dataspace, properties);
+	}
+	template<class Type>
+	void H5AppendRow(H5::DataSet &dataset, const std::vector<Type> &data) {
+		hsize_t dims[2];
+		dataset.getSpace().getSimpleExtentDims(dims, NULL);
+		if (data.size() != dims[1]) {
+			throw std::invalid_argument("in \"H5AppendRow\", row size doesn't match the dataset");
+		}
+
+		hsize_t new_dims[2] = { dims[0] + 1, dims[1] };
+		dataset.extend(new_dims);
+
+		hsize_t offset[2] = { dims[0], 0       };
+		hsize_t count[2]  = { 1,       dims[1] };
+		H5::DataSpace filespace = dataset.getSpace();
+		filespace.selectHyperslab(H5S_SELECT_SET, count, offset);
+		H5::DataSpace memspace(2, count);
+
+		dataset.write(data.data(), H5DataType(Type()), memspace, filespace);
+	}
+	inline hsize_t H5NumRows(H5::Group &group, const char* data_name) {
+		H5::DataSet dataset = group.openDataSet(data_name);
+
+		hsize_t dims[2];
+		dataset.getSpace().getSimpleExtentDims(dims, NULL);
+		dataset.close();
+
+		return dims[0];
+	}
+	/* partial reads of an extensible dataset: a single row (timestep) or a single column (node history) */
+	template<class Type>
+	void H5ReadRow(H5::Group &group, std::vector<Type> &data, const char* data_name, hsize_t row) {
+		H5::DataSet   dataset   = group.openDataSet(data_name);
+		H5::DataSpace filespace = dataset.getSpace();
+
+		hsize_t dims[2];
+		filespace.getSimpleExtentDims(dims, NULL);
+		if (row >= dims[0]) {
+			throw std::out_of_range("in \"H5ReadRow\", row out of range");
+		}
+
+		hsize_t offset[2] = { row, 0       };
+		hsize_t count[2]  = { 1,   dims[1] };
+		filespace.selectHyperslab(H5S_SELECT_SET, count, offset);
+		H5::DataSpace memspace(2, count);
+
+		data.resize(dims[1]);
+		dataset.read(data.data(), H5DataType(Type()), memspace, filespace);
+		dataset.close();
+	}
+	template<class Type>
+	void H5ReadColumn(H5::Group &group, std::vector<Type> &data, const char* data_name, hsize_t col) {
+		H5::DataSet   dataset   = group.openDataSet(data_name);
+		H5::DataSpace filespace = dataset.getSpace();
+
+		hsize_t dims[2];
+		filespace.getSimpleExtentDims(dims, NULL);
+		if (col >= dims[1]) {
+			throw std::out_of_range("in \"H5ReadColumn\", column out of range");
+		}
+
+		hsize_t offset[2] = { 0,       col };
+		hsize_t count[2]  = { dims[0], 1   };
+		filespace.selectHyperslab(H5S_SELECT_SET, count, offset);
+		H5::DataSpace memspace(2, count);
+
+		data.resize(dims[0]);
+		dataset.read(data.data(), H5DataType(Type()), memspace, filespace);
+		dataset.close();
+	}
 }
\ No newline at end of file
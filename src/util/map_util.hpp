@@ -1,6 +1,7 @@
 #pragma once
 
 #include <numeric>
+#include <array>
 #include <cmath>
 #include <numbers>
 #include <math.h>
@@ -20,4 +21,16 @@ namespace util::map {
 		Type d = R*c; // Distance in m
 		return d;
 	}
+
+	/* position on the unit sphere, the euclidean (chord) distance between two such points
+	grows with their great-circle distance, so closest points are the same for both */
+	template<typename Type>
+	std::array<Type, 3> latLon_to_unit_vector(Type lat, Type lon) {
+		Type lat_rad = math::deg_to_rad(lat);
+		Type lon_rad = math::deg_to_rad(lon);
+		return {
+			std::cos(lat_rad)*std::cos(lon_rad),
+			std::cos(lat_rad)*std::sin(lon_rad),
+			std::sin(lat_rad)};
+	}
 }
\ No newline at end of file
@@ -65,7 +65,7 @@ namespace util::math {
 
 	template<typename Type>
 	double get_KLdiv_single(const Type &P, const Type &Q) {
-		return get_KLdiv({P, 1-P}, {Q, 1-Q});
+		return get_KLdiv(std::vector<Type>{P, 1-P}, std::vector<Type>{Q, 1-Q});
 	}
 
 
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <vector>
+#include <span>
+#include <utility>
+#include <type_traits>
+#include <numeric>
+#include <algorithm>
+
+
+namespace util::matrix {
+	/* type of the elements of anything indexable as m[i][j] (nested std::vector, Matrix, MatrixView) */
+	template<class Matrix>
+	using element_type = std::remove_cvref_t<decltype(std::declval<const Matrix&>()[0][0])>;
+
+	/* non-owning view over a matrix stored in a single buffer, row i being data[offsets[i]] to data[offsets[i+1]-1].
+	Rows may have different sizes. Indexing works like a nested std::vector (m[i][j], m.size(), m[i].size()) */
+	template<typename T>
+	class MatrixView {
+	private:
+		T            *data_    = nullptr;
+		const size_t *offsets_ = nullptr;
+		size_t        num_rows = 0;
+
+	public:
+		MatrixView() {}
+		MatrixView(T *data, const size_t *offsets, size_t num_rows_) : data_(data), offsets_(offsets), num_rows(num_rows_) {}
+
+		inline size_t size() const {
+			return num_rows;
+		}
+		inline bool empty() const {
+			return num_rows == 0;
+		}
+		inline size_t row_size(size_t i) const {
+			return offsets_[i+1] - offsets_[i];
+		}
+		inline size_t num_elements() const {
+			return num_rows == 0 ? 0 : offsets_[num_rows];
+		}
+		inline T* data() const {
+			return data_;
+		}
+		inline std::span<T> operator[](size_t i) const {
+			return std::span<T>(data_ + offsets_[i], offsets_[i+1] - offsets_[i]);
+		}
+
+		/* view over rows [begin, end) */
+		inline MatrixView rows(size_t begin, size_t end) const {
+			return MatrixView(data_, offsets_ + begin, end - begin);
+		}
+
+		inline operator MatrixView<const T>() const {
+			return MatrixView<const T>(data_, offsets_, num_rows);
+		}
+	};
+
+	/* row offsets of a rectangular matrix, or of a matrix with the given row sizes */
+	inline std::vector<size_t> get_offsets(size_t num_rows, size_t num_cols) {
+		std::vector<size_t> offsets(num_rows+1);
+		for (size_t i = 0; i <= num_rows; ++i) {
+			offsets[i] = i*num_cols;
+		}
+		return offsets;
+	}
+	inline std::vector<size_t> get_offsets(const std::vector<size_t> &row_sizes) {
+		std::vector<size_t> offsets(row_sizes.size()+1, 0);
+		std::partial_sum(row_sizes.begin(), row_sizes.end(), offsets.begin()+1);
+		return offsets;
+	}
+	template<class Matrix>
+	std::vector<size_t> get_row_sizes(const Matrix &matrix) {
+		std::vector<size_t> row_sizes(matrix.size());
+		for (size_t i = 0; i < matrix.size(); ++i) {
+			row_sizes[i] = matrix[i].size();
+		}
+		return row_sizes;
+	}
+
+	/* matrix stored in a single allocation, or over an external buffer (for example a memory-mapped file) */
+	template<typename T>
+	class Matrix {
+	private:
+		std::vector<T>      storage;
+		std::vector<size_t> offsets;
+		T                  *external_data = nullptr;
+
+	public:
+		Matrix() : offsets(1, 0) {}
+		Matrix(size_t num_rows, size_t num_cols, T value=T()) :
+			storage(num_rows*num_cols, value), offsets(get_offsets(num_rows, num_cols)) {}
+		Matrix(const std::vector<size_t> &row_sizes, T value=T()) :
+			offsets(get_offsets(row_sizes))
+		{
+			storage.assign(offsets.back(), value);
+		}
+		Matrix(T *external_data_, size_t num_rows, size_t num_cols) :
+			offsets(get_offsets(num_rows, num_cols)), external_data(external_data_) {}
+		Matrix(T *external_data_, const std::vector<size_t> &row_sizes) :
+			offsets(get_offsets(row_sizes)), external_data(external_data_) {}
+
+		template<class Matrix2>
+		static Matrix from_rows(const Matrix2 &rows) {
+			Matrix matrix(get_row_sizes(rows));
+			for (size_t i = 0; i < rows.size(); ++i) {
+				std::copy(rows[i].begin(), rows[i].end(), matrix[i].begin());
+			}
+			return matrix;
+		}
+		std::vector<std::vector<T>> to_rows() const {
+			std::vector<std::vector<T>> rows(size());
+			for (size_t i = 0; i < size(); ++i) {
+				rows[i].assign((*this)[i].begin(), (*this)[i].end());
+			}
+			return rows;
+		}
+
+		inline size_t size() const {
+			return offsets.size()-1;
+		}
+		inline bool empty() const {
+			return size() == 0;
+		}
+		inline size_t row_size(size_t i) const {
+			return offsets[i+1] - offsets[i];
+		}
+		inline size_t num_elements() const {
+			return offsets.back();
+		}
+		inline T* data() {
+			return external_data == nullptr ? storage.data() : external_data;
+		}
+		inline const T* data() const {
+			return external_data == nullptr ? storage.data() : external_data;
+		}
+
+		inline std::span<T> operator[](size_t i) {
+			return std::span<T>(data() + offsets[i], offsets[i+1] - offsets[i]);
+		}
+		inline std::span<const T> operator[](size_t i) const {
+			return std::span<const T>(data() + offsets[i], offsets[i+1] - offsets[i]);
+		}
+
+		inline MatrixView<T> view() {
+			return MatrixView<T>(data(), offsets.data(), size());
+		}
+		inline MatrixView<const T> view() const {
+			return MatrixView<const T>(data(), offsets.data(), size());
+		}
+		inline MatrixView<T> rows(size_t begin, size_t end) {
+			return view().rows(begin, end);
+		}
+		inline MatrixView<const T> rows(size_t begin, size_t end) const {
+			return view().rows(begin, end);
+		}
+	};
+
+	/* K matrices sharing the same row sizes, stored one after the other in a single allocation
+	(or over an external buffer), t[k] being a view over the k-th matrix */
+	template<typename T>
+	class Tensor3 {
+	private:
+		std::vector<T>      storage;
+		std::vector<size_t> offsets;
+		size_t              num_slices    = 0;
+		T                  *external_data = nullptr;
+
+	public:
+		Tensor3() : offsets(1, 0) {}
+		Tensor3(size_t num_slices_, size_t num_rows, size_t num_cols, T value=T()) :
+			storage(num_slices_*num_rows*num_cols, value), offsets(get_offsets(num_rows, num_cols)), num_slices(num_slices_) {}
+		Tensor3(size_t num_slices_, const std::vector<size_t> &row_sizes, T value=T()) :
+			offsets(get_offsets(row_sizes)), num_slices(num_slices_)
+		{
+			storage.assign(num_slices*offsets.back(), value);
+		}
+		Tensor3(T *external_data_, size_t num_slices_, size_t num_rows, size_t num_cols) :
+			offsets(get_offsets(num_rows, num_cols)), num_slices(num_slices_), external_data(external_data_) {}
+		Tensor3(T *external_data_, size_t num_slices_, const std::vector<size_t> &row_sizes) :
+			offsets(get_offsets(row_sizes)), num_slices(num_slices_), external_data(external_data_) {}
+
+		inline size_t size() const {
+			return num_slices;
+		}
+		inline bool empty() const {
+			return num_slices == 0;
+		}
+		inline size_t num_rows() const {
+			return offsets.size()-1;
+		}
+		inline size_t slice_size() const {
+			return offsets.back();
+		}
+		inline T* data() {
+			return external_data == nullptr ? storage.data() : external_data;
+		}
+		inline const T* data() const {
+			return external_data == nullptr ? storage.data() : external_data;
+		}
+
+		inline MatrixView<T> operator[](size_t k) {
+			return MatrixView<T>(data() + k*slice_size(), offsets.data(), num_rows());
+		}
+		inline MatrixView<const T> operator[](size_t k) const {
+			return MatrixView<const T>(data() + k*slice_size(), offsets.data(), num_rows());
+		}
+	};
+}
@@ -0,0 +1,214 @@
+#pragma once
+
+#include <string>
+#include <cstring>
+#include <cerrno>
+#include <cstdint>
+#include <stdexcept>
+#include <algorithm>
+#include <utility>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "matrix.hpp"
+
+
+namespace util::mmap {
+	/* matrix (or K matrices of the same shape) stored as a raw binary file: a small header padded to
+	data_offset bytes, followed by the row-major elements, accessed through a shared memory mapping.
+	Only the pages that are touched are resident, and release() hands back the pages of finished rows */
+	template<typename T>
+	class mapped_matrix {
+	private:
+		static constexpr char   magic[8]    = {'B', 'P', 'S', 'M', 'A', 'T', '0', '1'};
+		static const     size_t data_offset = 4096;
+
+		struct header_type {
+			char     magic[8];
+			uint64_t element_size;
+			uint64_t num_slices, num_rows, num_cols;
+		};
+
+		std::string path;
+		int         fd        = -1;
+		char       *mapping   = nullptr;
+		size_t      file_size = 0;
+		bool        writable  = false;
+		header_type header;
+
+		void map_file(const char *function_name) {
+			mapping = (char*)::mmap(nullptr, file_size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+			if (mapping == MAP_FAILED) {
+				mapping = nullptr;
+				::close(fd);
+				throw std::runtime_error("in \"" + std::string(function_name) + "\", couldn't map \"" + path + "\": " + std::strerror(errno));
+			}
+		}
+		void close_file() {
+			if (mapping != nullptr) {
+				if (writable) {
+					::msync(mapping, file_size, MS_SYNC);
+				}
+				::munmap(mapping, file_size);
+				mapping = nullptr;
+			}
+			if (fd >= 0) {
+				::close(fd);
+				fd = -1;
+			}
+		}
+		inline void throw_if_not_writable(const char* function_name) const {
+			if (!writable) {
+				throw std::runtime_error("in \"" + std::string(function_name) + "\", \"" + path + "\" is mapped read-only, use the const accessor");
+			}
+		}
+
+	public:
+		/* creates (or truncates) the file */
+		mapped_matrix(const std::string &path_, size_t num_slices, size_t num_rows, size_t num_cols) : path(path_), writable(true) {
+			fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+			if (fd < 0) {
+				throw std::runtime_error("in \"mapped_matrix\", couldn't create \"" + path + "\": " + std::strerror(errno));
+			}
+
+			std::memcpy(header.magic, magic, sizeof(magic));
+			header.element_size = sizeof(T);
+			header.num_slices   = num_slices;
+			header.num_rows     = num_rows;
+			header.num_cols     = num_cols;
+
+			file_size = data_offset + num_slices*num_rows*num_cols*sizeof(T);
+			if (::ftruncate(fd, file_size) != 0) {
+				::close(fd);
+				throw std::runtime_error("in \"mapped_matrix\", couldn't resize \"" + path + "\": " + std::strerror(errno));
+			}
+
+			map_file("mapped_matrix");
+			std::memcpy(mapping, &header, sizeof(header_type));
+		}
+		mapped_matrix(const std::string &path_, size_t num_rows, size_t num_cols) : mapped_matrix(path_, 1, num_rows, num_cols) {}
+
+		/* opens an existing file */
+		mapped_matrix(const std::string &path_, bool writable_=false) : path(path_), writable(writable_) {
+			fd = ::open(path.c_str(), writable ? O_RDWR : O_RDONLY);
+			if (fd < 0) {
+				throw std::runtime_error("in \"mapped_matrix\", couldn't open \"" + path + "\": " + std::strerror(errno));
+			}
+
+			if (::pread(fd, &header, sizeof(header_type), 0) != sizeof(header_type) ||
+				std::memcmp(header.magic, magic, sizeof(magic)) != 0)
+			{
+				::close(fd);
+				throw std::runtime_error("in \"mapped_matrix\", \"" + path + "\" is not a matrix file");
+			}
+			if (header.element_size != sizeof(T)) {
+				::close(fd);
+				throw std::runtime_error("in \"mapped_matrix\", element size of \"" + path + "\" doesn't match the requested type");
+			}
+
+			file_size = data_offset + header.num_slices*header.num_rows*header.num_cols*sizeof(T);
+			struct stat file_stat;
+			if (::fstat(fd, &file_stat) != 0 || (size_t)file_stat.st_size < file_size) {
+				::close(fd);
+				throw std::runtime_error("in \"mapped_matrix\", \"" + path + "\" is truncated");
+			}
+
+			map_file("mapped_matrix");
+		}
+
+		mapped_matrix(const mapped_matrix&)            = delete;
+		mapped_matrix& operator=(const mapped_matrix&) = delete;
+		mapped_matrix(mapped_matrix &&other) :
+			path(std::move(other.path)), fd(other.fd), mapping(other.mapping), file_size(other.file_size), writable(other.writable), header(other.header)
+		{
+			other.fd      = -1;
+			other.mapping = nullptr;
+		}
+		mapped_matrix& operator=(mapped_matrix &&other) {
+			if (this != &other) {
+				close_file();
+
+				path      = std::move(other.path);
+				fd        = other.fd;
+				mapping   = other.mapping;
+				file_size = other.file_size;
+				writable  = other.writable;
+				header    = other.header;
+
+				other.fd      = -1;
+				other.mapping = nullptr;
+			}
+			return *this;
+		}
+
+		~mapped_matrix() {
+			close_file();
+		}
+
+		inline size_t num_slices() const {
+			return header.num_slices;
+		}
+		inline size_t num_rows() const {
+			return header.num_rows;
+		}
+		inline size_t num_cols() const {
+			return header.num_cols;
+		}
+		inline bool is_writable() const {
+			return writable;
+		}
+
+		/* the mutable accessors throw if the file was opened read-only, the const ones are always available */
+		inline T* data() {
+			throw_if_not_writable("mapped_matrix::data");
+			return (T*)(mapping + data_offset);
+		}
+		inline const T* data() const {
+			return (const T*)(mapping + data_offset);
+		}
+
+		/* Matrix over the k-th slice, and Tensor3 over all the slices, both without copy */
+		inline ::util::matrix::Matrix<T> matrix(size_t slice=0) {
+			return ::util::matrix::Matrix<T>(data() + slice*num_rows()*num_cols(), num_rows(), num_cols());
+		}
+		inline const ::util::matrix::Matrix<T> matrix(size_t slice=0) const {
+			return ::util::matrix::Matrix<T>(const_cast<T*>(data()) + slice*num_rows()*num_cols(), num_rows(), num_cols());
+		}
+		inline ::util::matrix::Tensor3<T> tensor() {
+			return ::util::matrix::Tensor3<T>(data(), num_slices(), num_rows(), num_cols());
+		}
+		inline const ::util::matrix::Tensor3<T> tensor() const {
+			return ::util::matrix::Tensor3<T>(const_cast<T*>(data()), num_slices(), num_rows(), num_cols());
+		}
+
+		/* writes back rows [begin, end) of every slice (asynchronously) and drops their pages from the resident memory,
+		they are read back from the file if accessed again. Should only be called once no thread accesses these rows */
+		void release(size_t begin, size_t end) {
+			static const size_t page_size = ::sysconf(_SC_PAGESIZE);
+
+			for (size_t slice = 0; slice < num_slices(); ++slice) {
+				const size_t first_byte = data_offset + ((slice*num_rows() + begin)*num_cols())*sizeof(T);
+				const size_t last_byte  = data_offset + ((slice*num_rows() + end  )*num_cols())*sizeof(T);
+
+				const size_t page_begin = first_byte/page_size*page_size;
+				const size_t page_end   = std::min(file_size, (last_byte + page_size - 1)/page_size*page_size);
+				if (page_end <= page_begin) {
+					continue;
+				}
+
+				if (writable) {
+					::msync(mapping + page_begin, page_end - page_begin, MS_ASYNC);
+				}
+				::madvise(mapping + page_begin, page_end - page_begin, MADV_DONTNEED);
+			}
+		}
+
+		/* rows are going to be read sequentially, tile after tile */
+		void advise_sequential() {
+			::madvise(mapping, file_size, MADV_SEQUENTIAL);
+		}
+	};
+}
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <vector>
+#include <span>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <type_traits>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+	#include <immintrin.h>
+#endif
+
+
+namespace util::simd {
+	/* proportions below epsilon are ignored, and reference proportions clamped to epsilon, like util::math::get_KLdiv */
+	static const double KLdiv_epsilon = 1e-18;
+
+	/* log2 through the exponent of x and an atanh series on its mantissa m in [sqrt(1/2), sqrt(2)),
+	with an absolute error below 5e-11 for any positive normal x (x is not checked) */
+	inline double log2_fast(double x) {
+		static const double sqrt2 = 1.4142135623730951;
+		static const double c1 = 2.8853900817779268, c3 = 0.9617966939259756, c5 = 0.5770780163555854,
+			c7 = 0.4121985831111324, c9 = 0.3205988979753252, c11 = 0.2623081892525388;
+
+		const uint64_t bits     = std::bit_cast<uint64_t>(x);
+		double         exponent = (double)((int64_t)((bits >> 52) & 0x7ff) - 1023);
+		double         mantissa = std::bit_cast<double>((bits & 0x000fffffffffffffull) | 0x3ff0000000000000ull);
+		if (mantissa > sqrt2) {
+			mantissa *= 0.5;
+			exponent += 1;
+		}
+
+		const double s  = (mantissa - 1)/(mantissa + 1);
+		const double s2 = s*s;
+		return exponent + s*(c1 + s2*(c3 + s2*(c5 + s2*(c7 + s2*(c9 + s2*c11)))));
+	}
+
+	template<bool fast_log2>
+	inline double log2(double x) {
+		if constexpr (fast_log2) {
+			return log2_fast(x);
+		} else {
+			return std::log2(x);
+		}
+	}
+
+	/* log2 of the reference distribution clamped to epsilon, to be passed to get_KLdivs */
+	template<class Vector>
+	std::vector<double> get_log2_reference(const Vector &Q) {
+		std::vector<double> log2_Q(Q.size());
+		for (size_t k = 0; k < Q.size(); ++k) {
+			log2_Q[k] = std::log2(std::max(KLdiv_epsilon, (double)Q[k]));
+		}
+		return log2_Q;
+	}
+
+	namespace {
+		template<bool fast_log2, typename Type>
+		inline void get_KLdivs_scalar(std::span<const Type* const> P, std::span<const double> log2_Q, size_t begin, size_t end, double *KLdivs) {
+			for (size_t j = begin; j < end; ++j) {
+				double KLdiv = 0;
+				for (size_t k = 0; k < P.size(); ++k) {
+					const double p = P[k][j];
+					if (p > KLdiv_epsilon) {
+						KLdiv += p*(log2<fast_log2>(p) - log2_Q[k]);
+					}
+				}
+				KLdivs[j] = KLdiv;
+			}
+		}
+
+#if defined(__AVX512F__)
+		static const size_t vector_width = 8;
+
+		inline __m512d load(const double *ptr) {
+			return _mm512_loadu_pd(ptr);
+		}
+		inline __m512d load(const float *ptr) {
+			return _mm512_cvtps_pd(_mm256_loadu_ps(ptr));
+		}
+
+		inline __m512d log2_fast(__m512d x) {
+			const __m512d one = _mm512_set1_pd(1);
+
+			__m512d exponent = _mm512_getexp_pd(x);
+			__m512d mantissa = _mm512_getmant_pd(x, _MM_MANT_NORM_1_2, _MM_MANT_SIGN_src);
+			__mmask8 high    = _mm512_cmp_pd_mask(mantissa, _mm512_set1_pd(1.4142135623730951), _CMP_GT_OQ);
+			mantissa = _mm512_mask_mul_pd(mantissa, high, mantissa, _mm512_set1_pd(0.5));
+			exponent = _mm512_mask_add_pd(exponent, high, exponent, one);
+
+			const __m512d s  = _mm512_div_pd(_mm512_sub_pd(mantissa, one), _mm512_add_pd(mantissa, one));
+			const __m512d s2 = _mm512_mul_pd(s, s);
+			__m512d poly = _mm512_fmadd_pd(s2, _mm512_set1_pd(0.2623081892525388), _mm512_set1_pd(0.3205988979753252));
+			poly = _mm512_fmadd_pd(s2, poly, _mm512_set1_pd(0.4121985831111324));
+			poly = _mm512_fmadd_pd(s2, poly, _mm512_set1_pd(0.5770780163555854));
+			poly = _mm512_fmadd_pd(s2, poly, _mm512_set1_pd(0.9617966939259756));
+			poly = _mm512_fmadd_pd(s2, poly, _mm512_set1_pd(2.8853900817779268));
+			return _mm512_fmadd_pd(s, poly, exponent);
+		}
+
+		template<typename Type>
+		inline void get_KLdivs_vector(std::span<const Type* const> P, std::span<const double> log2_Q, size_t j, double *KLdivs) {
+			const __m512d epsilon = _mm512_set1_pd(KLdiv_epsilon);
+
+			__m512d KLdiv = _mm512_setzero_pd();
+			for (size_t k = 0; k < P.size(); ++k) {
+				const __m512d p    = load(P[k] + j);
+				__mmask8      mask = _mm512_cmp_pd_mask(p, epsilon, _CMP_GT_OQ);
+				__m512d       term = _mm512_mul_pd(p, _mm512_sub_pd(log2_fast(p), _mm512_set1_pd(log2_Q[k])));
+				KLdiv = _mm512_mask_add_pd(KLdiv, mask, KLdiv, term);
+			}
+			_mm512_storeu_pd(KLdivs + j, KLdiv);
+		}
+#elif defined(__AVX2__)
+		static const size_t vector_width = 4;
+
+		inline __m256d load(const double *ptr) {
+			return _mm256_loadu_pd(ptr);
+		}
+		inline __m256d load(const float *ptr) {
+			return _mm256_cvtps_pd(_mm_loadu_ps(ptr));
+		}
+
+		inline __m256d log2_fast(__m256d x) {
+			const __m256d one = _mm256_set1_pd(1);
+
+			/* the biased exponent is converted to double by or-ing it into the mantissa of 2^52 */
+			const __m256i bits     = _mm256_castpd_si256(x);
+			const __m256i exponent_bits = _mm256_or_si256(_mm256_srli_epi64(bits, 52), _mm256_castpd_si256(_mm256_set1_pd(4503599627370496.)));
+			__m256d exponent = _mm256_sub_pd(_mm256_castsi256_pd(exponent_bits), _mm256_set1_pd(4503599627370496. + 1023));
+			__m256d mantissa = _mm256_castsi256_pd(_mm256_or_si256(
+				_mm256_and_si256(bits, _mm256_set1_epi64x(0x000fffffffffffffll)),
+				_mm256_set1_epi64x(0x3ff0000000000000ll)));
+
+			const __m256d high = _mm256_cmp_pd(mantissa, _mm256_set1_pd(1.4142135623730951), _CMP_GT_OQ);
+			mantissa = _mm256_blendv_pd(mantissa, _mm256_mul_pd(mantissa, _mm256_set1_pd(0.5)), high);
+			exponent = _mm256_add_pd(exponent, _mm256_and_pd(high, one));
+
+			const __m256d s  = _mm256_div_pd(_mm256_sub_pd(mantissa, one), _mm256_add_pd(mantissa, one));
+			const __m256d s2 = _mm256_mul_pd(s, s);
+			__m256d poly = _mm256_add_pd(_mm256_mul_pd(s2, _mm256_set1_pd(0.2623081892525388)), _mm256_set1_pd(0.3205988979753252));
+			poly = _mm256_add_pd(_mm256_mul_pd(s2, poly), _mm256_set1_pd(0.4121985831111324));
+			poly = _mm256_add_pd(_mm256_mul_pd(s2, poly), _mm256_set1_pd(0.5770780163555854));
+			poly = _mm256_add_pd(_mm256_mul_pd(s2, poly), _mm256_set1_pd(0.9617966939259756));
+			poly = _mm256_add_pd(_mm256_mul_pd(s2, poly), _mm256_set1_pd(2.8853900817779268));
+			return _mm256_add_pd(_mm256_mul_pd(s, poly), exponent);
+		}
+
+		template<typename Type>
+		inline void get_KLdivs_vector(std::span<const Type* const> P, std::span<const double> log2_Q, size_t j, double *KLdivs) {
+			const __m256d epsilon = _mm256_set1_pd(KLdiv_epsilon);
+
+			__m256d KLdiv = _mm256_setzero_pd();
+			for (size_t k = 0; k < P.size(); ++k) {
+				const __m256d p    = load(P[k] + j);
+				const __m256d mask = _mm256_cmp_pd(p, epsilon, _CMP_GT_OQ);
+				const __m256d term = _mm256_mul_pd(p, _mm256_sub_pd(log2_fast(p), _mm256_set1_pd(log2_Q[k])));
+				KLdiv = _mm256_add_pd(KLdiv, _mm256_and_pd(mask, term));
+			}
+			_mm256_storeu_pd(KLdivs + j, KLdiv);
+		}
+#endif
+	}
+
+	/* KL-divergences of a batch of distributions against the same reference distribution Q:
+	KLdivs[j] = sum_k P[k][j]*log2(P[k][j]/Q[k]), P[k] pointing to the (contiguous) proportions of category k
+	and log2_Q being given by get_log2_reference.
+	With fast_log2 the polynomial log2_fast is used, vectorized with AVX-512 or AVX2 when compiled for it
+	(-mavx512f, -mavx2 -mfma or -march=native) and as a portable scalar loop otherwise */
+	template<bool fast_log2=false, typename Type>
+	void get_KLdivs(std::span<const Type* const> P, std::span<const double> log2_Q, std::span<double> KLdivs) {
+		size_t begin = 0;
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+		if constexpr (fast_log2 && (std::is_same_v<Type, double> || std::is_same_v<Type, float>)) {
+			for (; begin + vector_width <= KLdivs.size(); begin += vector_width) {
+				get_KLdivs_vector(P, log2_Q, begin, KLdivs.data());
+			}
+		}
+#endif
+
+		get_KLdivs_scalar<fast_log2>(P, log2_Q, begin, KLdivs.size(), KLdivs.data());
+	}
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <queue>
+#include <algorithm>
+#include <numeric>
+
+
+namespace util::spatial {
+	/* static k-d tree over points of dimension Dim, stored implicitly: the range [begin, end) at depth d
+	is split on axis d%Dim at its median mid, points before mid being lower or equal to splits[mid] on
+	that axis and points after mid greater or equal (mid is different for every split) */
+	template<typename Type, size_t Dim>
+	class kd_tree {
+	private:
+		static const size_t leaf_size = 16;
+
+		std::vector<std::array<Type, Dim>> points;
+		std::vector<size_t>                indexes;
+		std::vector<Type>                  splits;
+
+		typedef std::pair<Type, size_t> candidate_type;
+
+		void build(size_t begin, size_t end, size_t depth) {
+			if (end - begin <= leaf_size) {
+				return;
+			}
+
+			const size_t axis = depth%Dim;
+			const size_t mid  = (begin + end)/2;
+
+			std::vector<size_t> order(end - begin);
+			std::iota(order.begin(), order.end(), begin);
+			std::nth_element(order.begin(), order.begin() + (mid - begin), order.end(), [&](size_t i, size_t j) {
+				return points[i][axis] < points[j][axis];
+			});
+
+			std::vector<std::array<Type, Dim>> sorted_points( end - begin);
+			std::vector<size_t>                sorted_indexes(end - begin);
+			for (size_t i = 0; i < order.size(); ++i) {
+				sorted_points[ i] = points[ order[i]];
+				sorted_indexes[i] = indexes[order[i]];
+			}
+			std::copy(sorted_points.begin(),  sorted_points.end(),  points.begin()  + begin);
+			std::copy(sorted_indexes.begin(), sorted_indexes.end(), indexes.begin() + begin);
+			splits[mid] = points[mid][axis];
+
+			build(begin, mid, depth+1);
+			build(mid,   end, depth+1);
+		}
+
+		inline Type squared_distance(const std::array<Type, Dim> &point1, const std::array<Type, Dim> &point2) const {
+			Type distance = 0;
+			for (size_t axis = 0; axis < Dim; ++axis) {
+				distance += (point1[axis] - point2[axis])*(point1[axis] - point2[axis]);
+			}
+			return distance;
+		}
+
+		void search(const std::array<Type, Dim> &point, size_t k, size_t begin, size_t end, size_t depth,
+			std::priority_queue<candidate_type> &candidates) const
+		{
+			if (end - begin <= leaf_size) {
+				for (size_t i = begin; i < end; ++i) {
+					candidate_type candidate = {squared_distance(point, points[i]), indexes[i]};
+					if (candidates.size() < k) {
+						candidates.push(candidate);
+					} else if (candidate < candidates.top()) {
+						candidates.pop();
+						candidates.push(candidate);
+					}
+				}
+				return;
+			}
+
+			const size_t axis = depth%Dim;
+			const size_t mid  = (begin + end)/2;
+			const Type   diff = point[axis] - splits[mid];
+
+			if (diff < 0) {
+				search(point, k, begin, mid, depth+1, candidates);
+				if (candidates.size() < k || diff*diff <= candidates.top().first) {
+					search(point, k, mid, end, depth+1, candidates);
+				}
+			} else {
+				search(point, k, mid, end, depth+1, candidates);
+				if (candidates.size() < k || diff*diff <= candidates.top().first) {
+					search(point, k, begin, mid, depth+1, candidates);
+				}
+			}
+		}
+
+	public:
+		kd_tree(const std::vector<std::array<Type, Dim>> &points_) : points(points_), indexes(points_.size()), splits(points_.size()) {
+			std::iota(indexes.begin(), indexes.end(), 0);
+			build(0, points.size(), 0);
+		}
+
+		inline size_t size() const {
+			return points.size();
+		}
+
+		/* indexes of the k closest points, by increasing distance (and increasing index for equal
+		distances), so the result for k is always a prefix of the result for any larger k */
+		std::vector<size_t> k_nearest(const std::array<Type, Dim> &point, size_t k) const {
+			k = std::min(k, size());
+
+			std::priority_queue<candidate_type> candidates;
+			if (k > 0) {
+				search(point, k, 0, size(), 0, candidates);
+			}
+
+			std::vector<size_t> nearest(candidates.size());
+			for (size_t i = nearest.size(); i > 0; --i) {
+				nearest[i-1] = candidates.top().second;
+				candidates.pop();
+			}
+			return nearest;
+		}
+	};
+}
@@ -2,12 +2,15 @@
 
 #include <random>
 #include <ostream>
+#include <vector>
+#include <span>
+#include <array>
 #include <omp.h>
 
 
 int max_print = 20;
-template<typename objClass>
-std::ostream &operator<<(std::ostream &os, const std::vector<objClass> &obj) {
+template<typename objClass, size_t Extent>
+std::ostream &operator<<(std::ostream &os, const std::span<objClass, Extent> &obj) {
 	for (int i = 0; i < obj.size(); ++i) {
 		os << obj[i];
 		if (i == max_print) {
@@ -20,6 +23,14 @@ std::ostream &operator<<(std::ostream &os, const std::vector<objClass> &obj) {
 	}
     return os;
 }
+template<typename objClass>
+std::ostream &operator<<(std::ostream &os, const std::vector<objClass> &obj) {
+    return os << std::span<const objClass>(obj);
+}
+template<typename objClass, size_t N>
+std::ostream &operator<<(std::ostream &os, const std::array<objClass, N> &obj) {
+    return os << std::span<const objClass, N>(obj);
+}
 
 
 namespace util {
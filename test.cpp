@@ -1,4 +1,5 @@
 #include <iostream>
+#include <cstdio>
 
 #include "src/core/network.hpp"
 #include "src/core/networks/network_generator.hpp"
@@ -13,6 +14,8 @@
 #include "src/implementations/population_voter_model_stubborn.hpp"
 #include "src/implementations/population_Nvoter_model.hpp"
 #include "src/implementations/population_Nvoter_stubborn_model.hpp"
+#include "src/core/segregation/multiscalar.hpp"
+#include "src/core/segregation/out_of_core.hpp"
 #include "src/util/util.hpp"
 
 
@@ -52,6 +55,8 @@ int main() {
 		}
 		std::cout << "\n";
 
+		test->freeze();
+
 		BPsimulation::implem::voter_interaction_function *interaction = new BPsimulation::implem::voter_interaction_function();
 		for (int i = 0; i < 10; ++i) {
 			if (i%1 == 0) {
@@ -62,6 +67,34 @@ int main() {
 
 			test->interact(interaction);
 		}
+
+		/* any callable can be passed by reference, and is inlined into the node loop */
+		test->interact([](BPsimulation::implem::voter &agent, BPsimulation::core::agent::NeighborView<BPsimulation::implem::voter> neighbors) {
+			size_t num_neighbors_true = 0;
+			for (size_t idx = 0; idx < neighbors.size(); ++idx) {
+				num_neighbors_true += neighbors.agent(idx)->candidate;
+			}
+			agent.candidate = 2*num_neighbors_true > neighbors.size() || (2*num_neighbors_true == neighbors.size() && agent.candidate);
+		});
+		BPsimulation::implem::voter_majority_election_result *majority_rule_result = (BPsimulation::implem::voter_majority_election_result*)test->get_election_results(election);
+		std::cout << "\nafter a majority rule step, network->get_election_results(...) = " << majority_rule_result->result << " (" << int(majority_rule_result->proportion*100) << "%)\n";
+
+		/* asynchronous updates, one color class at a time */
+		test->interact_colored(interaction);
+
+		std::vector<size_t> node_colors(test->num_nodes());
+		for (size_t color = 0; color < test->num_colors(); ++color) {
+			for (uint32_t node : test->color_class(color)) {
+				node_colors[node] = color;
+			}
+		}
+		size_t num_conflicts = 0;
+		for (size_t node = 0; node < test->num_nodes(); ++node) {
+			for (uint32_t neighbor : test->neighbors(node)) {
+				num_conflicts += neighbor != node && node_colors[neighbor] == node_colors[node];
+			}
+		}
+		std::cout << "network.num_colors() = " << test->num_colors() << ", adjacent nodes sharing a color: " << num_conflicts << "\n";
 	}
 
 	std::cout << "\n\n\nstubborn VOTER MODEL:\n\n";
@@ -426,4 +459,99 @@ int main() {
 			test->update_agentwise(renormalize);
 		}
 	}
+
+	std::cout << "\n\n\nSEGREGATION:\n\n";
+
+	{
+		const size_t num_units = 16;
+
+		/* fractional populations, with some units having a null population */
+		std::vector<std::vector<double>> vects(2, std::vector<double>(num_units));
+		std::vector<double>              positions(num_units);
+		for (size_t i = 0; i < num_units; ++i) {
+			vects[0][i]  = i%5 == 3 ? 0 : 0.1 + 0.37*((i*7)%5);
+			vects[1][i]  = i%5 == 3 ? 0 : 0.3 + 0.21*((i*3)%4);
+			positions[i] = std::sin(1.3*i);
+		}
+
+		std::vector<std::vector<size_t>> indexes(num_units, std::vector<size_t>(num_units));
+		for (size_t i = 0; i < num_units; ++i) {
+			std::iota(indexes[i].begin(), indexes[i].end(), 0);
+			std::sort(indexes[i].begin(), indexes[i].end(), [&](size_t j1, size_t j2) {
+				return std::abs(positions[j1] - positions[i]) < std::abs(positions[j2] - positions[i]);
+			});
+		}
+
+		auto trajectories       = segregation::multiscalar::get_trajectories(vects, indexes);
+		auto KLdiv_trajectories = segregation::multiscalar::get_KLdiv_trajectories(trajectories);
+		auto distortion_coefs   = segregation::multiscalar::get_distortion_coefs_from_KLdiv(KLdiv_trajectories);
+
+		auto distortion_coefs_fast = segregation::multiscalar::get_distortion_coefs_fast(vects, indexes);
+
+		double max_difference = 0;
+		for (size_t i = 0; i < num_units; ++i) {
+			max_difference = std::max(max_difference, std::abs(distortion_coefs[i] - distortion_coefs_fast[i]));
+		}
+		std::cout << "get_distortion_coefs_from_KLdiv(...) = " << distortion_coefs      << "\n";
+		std::cout << "get_distortion_coefs_fast(...)       = " << distortion_coefs_fast << "\n";
+		std::cout << "max difference = " << max_difference << "\n";
+	}
+
+	{
+		const size_t num_units = 23, num_neighbors = 10;
+
+		std::vector<std::vector<double>> vects(2, std::vector<double>(num_units));
+		std::vector<double>              lat(num_units), lon(num_units);
+		for (size_t i = 0; i < num_units; ++i) {
+			vects[0][i] = 1 + (i*7)%5;
+			vects[1][i] = 2 + (i*3)%4;
+			lat[i]      = 45 + 0.1*std::sin(1.3*i);
+			lon[i]      =  2 + 0.1*std::cos(0.7*i);
+		}
+
+		/* in-core reference */
+		auto distances          = segregation::map::util::get_distances(lat, lon);
+		auto indexes            = segregation::multiscalar::get_closest_neighbors(distances, num_neighbors);
+		auto KLdiv_trajectories = segregation::multiscalar::get_KLdiv_trajectories(
+			segregation::multiscalar::get_trajectories(vects, indexes),
+			segregation::multiscalar::util::get_total_distribution(vects));
+		auto distortion_coefs   = segregation::multiscalar::get_distortion_coefs_from_KLdiv(KLdiv_trajectories);
+
+		/* tile sizes that don't divide the number of units */
+		for (size_t tile_size : {5, 7}) {
+			::util::mmap::mapped_matrix<double> distances_file("test_distances.bin", num_units, num_units);
+			::util::mmap::mapped_matrix<size_t> indexes_file(  "test_indexes.bin",   num_units, num_neighbors);
+			::util::mmap::mapped_matrix<double> KLdiv_file(    "test_KLdiv.bin",     num_units, num_neighbors);
+
+			segregation::multiscalar::out_of_core::get_distances(lat, lon, distances_file, tile_size);
+			segregation::multiscalar::out_of_core::get_closest_neighbors(distances_file, indexes_file, tile_size);
+			segregation::multiscalar::out_of_core::get_KLdiv_trajectories(vects, indexes_file, KLdiv_file, tile_size);
+
+			/* reopened read-only, only the const accessors being available */
+			KLdiv_file = ::util::mmap::mapped_matrix<double>("test_KLdiv.bin");
+			auto distortion_coefs_tiled = segregation::multiscalar::out_of_core::get_distortion_coefs_from_KLdiv(KLdiv_file, 1.d, tile_size);
+
+			const auto &distances_tiled = std::as_const(distances_file).matrix();
+			const auto &indexes_tiled   = std::as_const(indexes_file).matrix();
+			const auto &KLdiv_tiled     = std::as_const(KLdiv_file).matrix();
+
+			double max_difference     = 0;
+			size_t num_index_mismatch = 0;
+			for (size_t i = 0; i < num_units; ++i) {
+				for (size_t j = 0; j < num_units; ++j) {
+					max_difference = std::max(max_difference, std::abs(distances[i][j] - distances_tiled[i][j]));
+				}
+				for (size_t j = 0; j < num_neighbors; ++j) {
+					num_index_mismatch += indexes[i][j] != indexes_tiled[i][j];
+					max_difference      = std::max(max_difference, std::abs(KLdiv_trajectories[i][j] - KLdiv_tiled[i][j]));
+				}
+				max_difference = std::max(max_difference, std::abs(distortion_coefs[i] - distortion_coefs_tiled[i]));
+			}
+			std::cout << "\nout_of_core, tile_size = " << tile_size << ": max difference = " << max_difference << ", index mismatches = " << num_index_mismatch << "\n";
+		}
+
+		std::remove("test_distances.bin");
+		std::remove("test_indexes.bin");
+		std::remove("test_KLdiv.bin");
+	}
 }
\ No newline at end of file
@@ -0,0 +1,184 @@
+#include <iostream>
+#include <cstdio>
+
+#include "src/core/network.hpp"
+#include "src/core/networks/network_generator.hpp"
+#include "src/core/networks/network_partition.hpp"
+#include "src/core/networks/network_util.hpp"
+#include "src/core/networks/network_file_io.hpp"
+#include "src/core/networks/network_async_file_io.hpp"
+#include "src/implementations/voter_model.hpp"
+#include "src/implementations/Nvoter_stubborn_model.hpp"
+#include "src/util/hdf5_util.hpp"
+#include "src/util/util.hpp"
+
+
+int main() {
+	const int N_candidates = 3;
+	typedef BPsimulation::implem::Nvoter_stubborn<N_candidates> agent_type;
+	typedef BPsimulation::core::agent::AgentSerializerTemplate<agent_type> serializer_type;
+
+	auto *serializer = new BPsimulation::implem::NVoterstubbornSerializer<N_candidates>();
+
+	auto *test = new BPsimulation::SocialNetwork<agent_type>(20);
+	BPsimulation::random::preferential_attachment(test, 2);
+	BPsimulation::random::network_randomize_agent_states(test, 0.1, std::vector<double>{0.5, 0.2, 0.3});
+
+	std::vector<int> candidates(test->num_nodes());
+	for (size_t node = 0; node < test->num_nodes(); ++node) {
+		candidates[node] = (*test)[node].candidate;
+	}
+
+	std::cout << "NETWORK I/O:\n\n";
+
+	{
+		H5::H5File file = util::hdf5io::open_truncate_if_needed("test_io.h5");
+		BPsimulation::io::write_network_to_file(test, file);
+		BPsimulation::io::write_agent_states_to_file(test, serializer, file);
+
+		auto *reread = new BPsimulation::SocialNetwork<agent_type>();
+		reread->freeze();
+		BPsimulation::io::read_network_from_file(reread, file);
+		BPsimulation::io::read_agent_states_from_file(reread, serializer, file);
+
+		std::cout << "network.degrees() = " << test->degrees()   << "\n";
+		std::cout << "reread.degrees()  = " << reread->degrees() << "\n";
+		std::cout << "network.neighbors(1) = " << test->neighbors(1)   << "\n";
+		std::cout << "reread.neighbors(1)  = " << reread->neighbors(1) << "\n";
+		std::cout << "reread.is_frozen() = " << reread->is_frozen() << "\n";
+		std::cout << "network[1] = " << (*test)[1].candidate   << ", reread[1] = " << (*reread)[1].candidate << "\n";
+	}
+
+	std::cout << "\n\n\nSHARDED I/O:\n\n";
+
+	{
+		const size_t num_shards = 3;
+
+		std::vector<H5::H5File> files;
+		for (size_t shard = 0; shard < num_shards; ++shard) {
+			std::string filename = "test_io_shard_" + std::to_string(shard) + ".h5";
+			files.push_back(util::hdf5io::open_truncate_if_needed(filename.c_str()));
+
+			BPsimulation::io::write_network_shard_to_file(     test,             files.back(), shard, num_shards);
+			BPsimulation::io::write_agent_states_shard_to_file(test, serializer, files.back(), shard, num_shards);
+
+			auto [begin, end] = BPsimulation::io::get_shard_range(test->num_nodes(), shard, num_shards);
+			std::cout << "shard " << shard << " = [" << begin << ", " << end << ")\n";
+		}
+
+		/* shards can be read in any order */
+		std::swap(files[0], files[2]);
+
+		auto *reread = new BPsimulation::SocialNetwork<agent_type>();
+		BPsimulation::io::read_network_from_shards(reread, std::span<H5::H5File>(files));
+		for (H5::H5File &file : files) {
+			BPsimulation::io::read_agent_states_shard_from_file(reread, serializer, file);
+		}
+
+		std::vector<int> reread_candidates(reread->num_nodes());
+		for (size_t node = 0; node < reread->num_nodes(); ++node) {
+			reread_candidates[node] = (*reread)[node].candidate;
+		}
+
+		std::cout << "\nnetwork.degrees() = " << test->degrees()   << "\n";
+		std::cout << "reread.degrees()  = " << reread->degrees() << "\n";
+		std::cout << "network.candidates = " << candidates        << "\n";
+		std::cout << "reread.candidates  = " << reread_candidates << "\n";
+	}
+
+	std::cout << "\n\n\nSTATE TRAJECTORY:\n\n";
+
+	{
+		H5::H5File file = util::hdf5io::open_truncate_if_needed("test_io_trajectory.h5");
+
+		util::hdf5io::H5ChunkOptions options;
+		options.chunk_rows    = 4;
+		options.deflate_level = 4;
+		options.shuffle       = true;
+
+		const size_t     history_node = 7;
+		std::vector<int> history_node_candidates;
+
+		{
+			BPsimulation::io::AsyncAgentStatesWriter<agent_type> writer(serializer, file, test->num_nodes(), 1 << 20, "/states_trajectory", options);
+
+			BPsimulation::implem::Nvoter_stubborn_interaction_function<N_candidates> *interaction = new BPsimulation::implem::Nvoter_stubborn_interaction_function<N_candidates>();
+			for (int i = 0; i < 10; ++i) {
+				writer.push(test);
+				history_node_candidates.push_back((*test)[history_node].candidate);
+
+				test->interact(interaction);
+			}
+			writer.flush(file);
+		}
+
+		/* reopening an existing trajectory appends to it */
+		{
+			BPsimulation::io::AgentStatesTrajectoryWriter<agent_type> writer(serializer, file, test->num_nodes());
+			std::cout << "reopened num_timesteps() = " << writer.num_timesteps() << "\n";
+
+			writer.append(test);
+			history_node_candidates.push_back((*test)[history_node].candidate);
+			std::cout << "appended num_timesteps() = " << writer.num_timesteps() << "\n";
+		}
+
+		auto history = BPsimulation::io::read_agent_state_history_from_file(serializer, file, history_node);
+		std::cout << "\nnetwork[" << history_node << "] history        = " << history_node_candidates << "\n";
+		std::cout << "read_agent_state_history  = " << serializer_type::column<int>(history[0]) << "\n";
+
+		auto *reread = new BPsimulation::SocialNetwork<agent_type>(test->num_nodes());
+		BPsimulation::io::read_agent_states_timestep_from_file(reread, serializer, file, 10);
+
+		std::vector<int> last_candidates(test->num_nodes()), reread_candidates(reread->num_nodes());
+		for (size_t node = 0; node < test->num_nodes(); ++node) {
+			last_candidates[  node] = (*test  )[node].candidate;
+			reread_candidates[node] = (*reread)[node].candidate;
+		}
+		std::cout << "network.candidates     = " << last_candidates   << "\n";
+		std::cout << "timestep 10 candidates = " << reread_candidates << "\n";
+	}
+
+	std::cout << "\n\n\nELECTION RESULTS:\n\n";
+
+	{
+		H5::H5File file = util::hdf5io::open_truncate_if_needed("test_io_elections.h5");
+
+		auto *election   = new BPsimulation::implem::Nvoter_majority_election<N_candidates, agent_type>();
+		auto *serializer = new BPsimulation::implem::NVoterMajorityElectionSerializer<N_candidates>();
+
+		std::vector<std::vector<size_t>> counties = BPsimulation::random::random_graphAgnostic_partition_graph(test, 3);
+		auto results = test->get_election_results(counties, election);
+
+		BPsimulation::io::write_election_results_to_file(results, serializer, file);
+		{
+			BPsimulation::io::ElectionResultsTrajectoryWriter writer(serializer, file, counties.size());
+			writer.append(results);
+			writer.append(results);
+		}
+
+		auto columns          = BPsimulation::io::read_election_results_from_file(serializer, file);
+		auto timestep_columns = BPsimulation::io::read_election_results_timestep_from_file(serializer, file, 1);
+
+		typedef BPsimulation::core::election::ElectionResultSerializerTemplate election_serializer_type;
+
+		std::vector<int>    county_results(counties.size());
+		std::vector<size_t> county_votes_1(counties.size());
+		for (size_t i = 0; i < counties.size(); ++i) {
+			auto *county_result = (BPsimulation::implem::Nvoter_majority_election_result<N_candidates>*)results[i];
+			county_results[i] = county_result->result;
+			county_votes_1[i] = county_result->votes[1];
+		}
+		std::cout << "network->get_election_results(counties, ...) = " << county_results << " (votes_1 = " << county_votes_1 << ")\n";
+		std::cout << "read_election_results_from_file             = " << election_serializer_type::column<int>(columns[0])
+			<< " (votes_1 = " << election_serializer_type::column<size_t>(columns[2]) << ")\n";
+		std::cout << "read_election_results_timestep_from_file    = " << election_serializer_type::column<int>(timestep_columns[0])
+			<< " (votes_1 = " << election_serializer_type::column<size_t>(timestep_columns[2]) << ")\n";
+	}
+
+	std::remove("test_io.h5");
+	for (size_t shard = 0; shard < 3; ++shard) {
+		std::remove(("test_io_shard_" + std::to_string(shard) + ".h5").c_str());
+	}
+	std::remove("test_io_trajectory.h5");
+	std::remove("test_io_elections.h5");
+}